@@ -1,23 +1,182 @@
 #pragma once
 
+#include "waitStrategy.h"
+
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <iterator>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
 
 namespace concurency
 {
+	/*
+		how a producer makes its written slot visible to the consumers
+
+		ordered - slots are committed in the order they were claimed (m_writeTail),
+			a producer preempted between the claim and the commit stalls all the others.
+		perSlot - every slot carries a sequence number (turn), a producer publishes its own slot
+			and a consumer waits only on the slot it reads.
+			the default of m2mQueue, in ordered mode its consumers also release their slots in order (m_readTail).
+	*/
+	enum class commitMode
+	{
+		ordered,
+		perSlot
+	};
+
+	/*
+		per slot sequence numbers, for slot i and lap k:
+			seq == i + k * Size      - free, waits for the producer of index i + k * Size
+			seq == i + k * Size + 1  - published, waits for the consumer of index i + k * Size
+	*/
+	template <size_t Size, commitMode Mode>
+	struct slotSequences
+	{
+		// ordered mode commits through m_writeTail, nothing to keep per slot
+	};
+
+	template <size_t Size>
+	struct slotSequences<Size, commitMode::perSlot>
+	{
+		slotSequences()
+		{
+			for (size_t i = 0; i < Size; ++i)
+				m_seq[i].store(i, std::memory_order_relaxed);
+		}
+
+		std::atomic<uint64_t>& operator[](uint64_t ind) { return m_seq[ind % Size]; }
+
+		std::atomic<uint64_t> m_seq[Size];
+	};
+
+	/*
+		ring storage of a queue, size() slots of which capacity() can hold values,
+		the rest is the slack for ThreadNum producers that passed the full check together.
+		the slots are raw storage, a value lives in a slot only between its push and its pop,
+		the queue constructs and destroys it.
+
+		fixedRing - sizes known at compile time, the slots are embedded in the queue.
+	*/
+	template <class T, size_t N, size_t ThreadNum, commitMode Mode>
+	class fixedRing
+	{
+	public:
+		using value_type = T;
+		static constexpr commitMode mode = Mode;
+
+		void* slot(uint64_t ind) { return &m_buffer[ind % size()]; }
+		T& operator[](uint64_t ind) { return *std::launder(reinterpret_cast<T*>(slot(ind))); }
+		std::atomic<uint64_t>& seq(uint64_t ind) { return m_slotSeq[ind]; }
+
+		constexpr size_t size()const { return sizeof(m_buffer) / sizeof(m_buffer[0]); }
+		constexpr size_t capacity()const { return N; }
+
+	private:
+		std::aligned_storage_t<sizeof(T), alignof(T)> m_buffer[N + ThreadNum + 1];
+		slotSequences<N + ThreadNum + 1, Mode> m_slotSeq;
+	};
 
-	template <class T, size_t N, size_t ThreadNum>
+	/*
+		heapRing - sizes given at construction, the number of slots is rounded up to a power of 2
+		so an index is masked instead of %, capacity() is what is left of it after the slack.
+		the slots and the slot sequences are one cache line aligned heap allocation.
+	*/
+	template <class T, commitMode Mode>
+	class heapRing
+	{
+	public:
+		using value_type = T;
+		static constexpr commitMode mode = Mode;
+
+		heapRing(size_t capacity, size_t threadNum)
+		{
+			size_t size{ 1 };
+			while (size < capacity + threadNum + 1)
+				size <<= 1;
+			m_mask = size - 1;
+			m_capacity = size - threadNum - 1;
+
+			const size_t buffersBytes = roundUp(size * sizeof(T), alignof(std::atomic<uint64_t>));
+			const size_t seqBytes = Mode == commitMode::perSlot ? size * sizeof(std::atomic<uint64_t>) : 0;
+			m_memory = ::operator new(buffersBytes + seqBytes, std::align_val_t{ Alignment });
+
+			m_buffer = static_cast<char*>(m_memory);
+
+			if constexpr (Mode == commitMode::perSlot)
+			{
+				m_seq = reinterpret_cast<std::atomic<uint64_t>*>(static_cast<char*>(m_memory) + buffersBytes);
+				for (size_t i = 0; i < size; ++i)
+					new (m_seq + i) std::atomic<uint64_t>{ i };
+			}
+		}
+		~heapRing()
+		{
+			::operator delete(m_memory, std::align_val_t{ Alignment });
+		}
+		heapRing(const heapRing&) = delete;
+		heapRing& operator=(const heapRing&) = delete;
+
+		void* slot(uint64_t ind) { return m_buffer + (ind & m_mask) * sizeof(T); }
+		T& operator[](uint64_t ind) { return *std::launder(reinterpret_cast<T*>(slot(ind))); }
+		std::atomic<uint64_t>& seq(uint64_t ind) { return m_seq[ind & m_mask]; }
+
+		size_t size()const { return m_mask + 1; }
+		size_t capacity()const { return m_capacity; }
+
+	private:
+		static constexpr size_t Alignment{ alignof(T) > 64 ? alignof(T) : 64 }; // at least a cache line
+		static size_t roundUp(size_t n, size_t alignment) { return (n + alignment - 1) / alignment * alignment; }
+
+		void* m_memory{ nullptr };
+		char* m_buffer{ nullptr };
+		std::atomic<uint64_t>* m_seq{ nullptr };
+		uint64_t m_mask{ 0 };
+		size_t m_capacity{ 0 };
+	};
+
+	/*
+		Ring - where the values live, see fixedRing/heapRing
+		Wait - how push_wait/pop_wait/try_pop_for wait for place/values, see waitStrategy.h
+	*/
+	template <class Ring, class Wait>
 	class queueBase
 	{
 	public:
-		queueBase() = default;
-		virtual ~queueBase() = default;
+		using value_type = typename Ring::value_type;
+		static constexpr commitMode Mode = Ring::mode;
+
+		// the arguments are passed to the ring, see fixedRing/heapRing
+		template <typename... Args>
+		explicit queueBase(Args&&... args) : m_ring(std::forward<Args>(args)...) {}
+		virtual ~queueBase()
+		{
+			// no one uses the queue anymore, what was pushed and not poped is still alive
+			for (uint64_t ind = m_readHead.load(); ind < m_writeHead.load(); ++ind)
+				m_ring[ind].~value_type();
+		}
+
+		size_t capacity()const { return m_ring.capacity(); }
 
 		template <typename U>
 		bool push(U&& v)
 		{
-			if (m_writeHead.load() - m_readHead.load() > N)
+			return emplace(std::forward<U>(v));
+		}
+
+		/*
+			constructs the value in its slot from args.
+			the constructor must not throw, the slot is already claimed and must be published.
+		*/
+		template <typename... Args>
+		bool emplace(Args&&... args)
+		{
+			if (full())
 				return false; // no place
 
 			// it's possible that queue is almost full (one place left) and ThreadNum of threads entered,
@@ -25,32 +184,166 @@ namespace concurency
 
 			// many threads write in paralel
 			const uint64_t ind = m_writeHead.fetch_add(1);
-			write(ind, std::forward<U>(v));
 
-			// increment tail in the right order
-			while (m_writeTail.load() != ind);
-			++m_writeTail;
+			if constexpr (Mode == commitMode::perSlot)
+			{
+				// the slot can still be read by a consumer of the previous lap (m2mQueue)
+				while (m_ring.seq(ind).load(std::memory_order_acquire) != ind);
+
+				write(ind, std::forward<Args>(args)...);
+
+				// publish only this slot, don't wait for the other producers
+				m_ring.seq(ind).store(ind + 1, std::memory_order_release);
+			}
+			else
+			{
+				write(ind, std::forward<Args>(args)...);
 
+				// increment tail in the right order
+				while (m_writeTail.load() != ind);
+				++m_writeTail;
+			}
+
+			m_notEmpty.notify();
 			return true;
 		}
 
+		// blocks while the queue is full
+		template <typename U>
+		void push_wait(U&& v)
+		{
+			emplace_wait(std::forward<U>(v));
+		}
+		template <typename... Args>
+		void emplace_wait(Args&&... args)
+		{
+			// emplace doesn't touch args when there is no place
+			while (!emplace(std::forward<Args>(args)...))
+				m_notFull.wait([this]() { return !full(); });
+		}
+
+		/*
+			pushes [first, last) as one block, reserved with a single CAS on m_writeHead.
+			returns how many were pushed from first, less than the range when there is no place for all.
+		*/
+		template <typename Iter>
+		size_t push_n(Iter first, Iter last)
+		{
+			const uint64_t count = static_cast<uint64_t>(std::distance(first, last));
+			if (count == 0)
+				return 0;
+
+			// reserve up to the same bound a single push may reach, the ThreadNum slack stays intact
+			uint64_t ind = m_writeHead.load();
+			uint64_t n{ 0 };
+			do
+			{
+				const uint64_t used = ind - readDone();
+				if (used > m_ring.capacity())
+					return 0; // no place
+				n = std::min<uint64_t>(count, m_ring.capacity() + 1 - used);
+			}
+			while (!m_writeHead.compare_exchange_weak(ind, ind + n));
+
+			if constexpr (Mode == commitMode::perSlot)
+			{
+				for (uint64_t i = ind; i < ind + n; ++i, ++first)
+				{
+					while (m_ring.seq(i).load(std::memory_order_acquire) != i);
+					write(i, *first);
+					m_ring.seq(i).store(i + 1, std::memory_order_release);
+				}
+			}
+			else
+			{
+				for (uint64_t i = ind; i < ind + n; ++i, ++first)
+					write(i, *first);
+
+				// commit the whole block at once, still in the right order
+				while (m_writeTail.load() != ind);
+				m_writeTail.fetch_add(n);
+			}
+
+			m_notEmpty.notify();
+			return static_cast<size_t>(n);
+		}
+
 	protected:
-		constexpr size_t sizeofArr()const { return sizeof(m_ringBuffer) / sizeof(m_ringBuffer[0]); }
+		bool full()
+		{
+			return m_writeHead.load() - readDone() > m_ring.capacity();
+		}
+
+		/*
+			the slots before it were moved out by the consumers and can be written again.
+			perSlot - m_readHead, a producer still waits on the sequence of its own slot
+			ordered - m_readTail, a claimed slot may still be in a consumer's hands
+		*/
+		uint64_t readDone()
+		{
+			if constexpr (Mode == commitMode::perSlot)
+				return m_readHead.load();
+			else
+				return m_readTail.load();
+		}
+
+		bool published(uint64_t ind)
+		{
+			if constexpr (Mode == commitMode::perSlot)
+				return m_ring.seq(ind).load(std::memory_order_acquire) == ind + 1;
+			else
+				return ind < m_writeTail.load();
+		}
+		// number of published slots in a row starting at ind, up to max
+		size_t publishedCount(uint64_t ind, size_t max)
+		{
+			if constexpr (Mode == commitMode::perSlot)
+			{
+				size_t n{ 0 };
+				while (n < max && m_ring.seq(ind + n).load(std::memory_order_acquire) == ind + n + 1)
+					++n;
+				return n;
+			}
+			else
+			{
+				const uint64_t tail = m_writeTail.load();
+				return tail > ind ? static_cast<size_t>(std::min<uint64_t>(tail - ind, max)) : 0;
+			}
+		}
+		void release(uint64_t ind)
+		{
+			// hand the slot to the producer of the next lap
+			if constexpr (Mode == commitMode::perSlot)
+				m_ring.seq(ind).store(ind + m_ring.size(), std::memory_order_release);
+		}
+		// one consumer, the slots before ind are done, a release store adds no barrier to the pop
+		void readTail(uint64_t ind)
+		{
+			if constexpr (Mode == commitMode::ordered)
+				m_readTail.store(ind, std::memory_order_release);
+		}
 
-		void write(uint64_t ind, T& v)
+		template <typename... Args>
+		void write(uint64_t ind, Args&&... args)
 		{
-			m_ringBuffer[ind % sizeofArr()] = v;
+			new (m_ring.slot(ind)) value_type(std::forward<Args>(args)...);
 		}
-		void write(uint64_t ind, T&& v)
+		// moves the value out of its slot to f and ends its life, the slot is raw storage again
+		template <typename F>
+		void consume(uint64_t ind, F&& f)
 		{
-			m_ringBuffer[ind % sizeofArr()] = std::move(v);
+			value_type& v = m_ring[ind];
+			f(std::move(v));
+			v.~value_type();
 		}
 
-		T m_ringBuffer[N + ThreadNum + 1];
+		Ring m_ring;
 		std::atomic<uint64_t> m_writeHead{ 0 };
 		std::atomic<uint64_t> m_writeTail{ 0 };
 		std::atomic<uint64_t> m_readHead{ 0 };
 		std::atomic<uint64_t> m_readTail{ 0 };
+		Wait m_notEmpty; // consumers wait on it
+		Wait m_notFull; // producers wait on it
 
 	private:
 		queueBase(const queueBase&) = delete;
@@ -64,104 +357,287 @@ namespace concurency
 
 
 	/*
-		Many producers to One consumer queue
-
-		N - queue size
-		ThreadNum - max number of threads using Q
+		Many producers to One consumer queue over any ring, see m2oQueue and m2oHeapQueue
 	*/
-	template <class T, size_t N, size_t ThreadNum>
-	class m2oQueue : public queueBase<T, N, ThreadNum>
+	template <class Ring, class Wait>
+	class m2oQueueBase : public queueBase<Ring, Wait>
 	{
 	public:
-		m2oQueue() {}
-		~m2oQueue() {}
+		using queueBase<Ring, Wait>::queueBase;
+		using typename queueBase<Ring, Wait>::value_type;
 
-		bool pop(T& out_v)
+		bool pop(value_type& out_v)
 		{
-			if (this->m_readHead.load() == this->m_writeTail.load())
-				return false; // empty
+			const uint64_t ind = this->m_readHead.load();
+			if (!this->published(ind))
+				return false; // empty, or the producer of ind didn't publish yet
 
-			out_v = std::move(this->m_ringBuffer[this->m_readHead.load() % this->sizeofArr()]);
+			this->consume(ind, [&out_v](value_type&& v) { out_v = std::move(v); });
+			this->release(ind);
 			++this->m_readHead;
+			this->readTail(ind + 1);
 
+			this->m_notFull.notify();
 			return true;
 		}
+
+		std::optional<value_type> try_pop()
+		{
+			std::optional<value_type> res;
+			const uint64_t ind = this->m_readHead.load();
+			if (!this->published(ind))
+				return res; // empty, or the producer of ind didn't publish yet
+
+			this->consume(ind, [&res](value_type&& v) { res.emplace(std::move(v)); });
+			this->release(ind);
+			++this->m_readHead;
+			this->readTail(ind + 1);
+
+			this->m_notFull.notify();
+			return res;
+		}
+
+		// blocks while the queue is empty
+		void pop_wait(value_type& out_v)
+		{
+			while (!pop(out_v))
+				this->m_notEmpty.wait([this]() { return this->published(this->m_readHead.load()); });
+		}
+
+		// waits up to timeout for a value
+		template <class Rep, class Period>
+		std::optional<value_type> try_pop_for(const std::chrono::duration<Rep, Period>& timeout)
+		{
+			std::optional<value_type> res = try_pop();
+			if (res)
+				return res;
+
+			const auto deadline = std::chrono::steady_clock::now() + timeout;
+			while (this->m_notEmpty.wait_until([this]() { return this->published(this->m_readHead.load()); }, deadline))
+			{
+				res = try_pop();
+				if (res)
+					break;
+			}
+			return res;
+		}
+
+		/*
+			moves up to max items to out, m_readHead is updated once.
+			returns how many were poped.
+		*/
+		template <typename OutIter>
+		size_t pop_n(OutIter out, size_t max)
+		{
+			const uint64_t ind = this->m_readHead.load();
+			const size_t n = this->publishedCount(ind, max);
+			if (n == 0)
+				return 0; // empty
+
+			for (uint64_t i = ind; i < ind + n; ++i)
+			{
+				this->consume(i, [&out](value_type&& v) { *out++ = std::move(v); });
+				this->release(i);
+			}
+			this->m_readHead.fetch_add(n);
+			this->readTail(ind + n);
+
+			this->m_notFull.notify();
+			return n;
+		}
 	};
 
 
 
 
 	/*
-		Many producers to Many consumers queue
-
-		N - queue size
-		ThreadNum - max number of threads using Q
+		Many producers to Many consumers queue over any ring, see m2mQueue and m2mHeapQueue
 	*/
-	template <class T, size_t N, size_t ThreadNum>
-	class m2mQueue : public queueBase<T, N, ThreadNum>
+	template <class Ring, class Wait>
+	class m2mQueueBase : public queueBase<Ring, Wait>
 	{
+		static constexpr commitMode Mode = Ring::mode;
+
+	public:
+		using queueBase<Ring, Wait>::queueBase;
+		using typename queueBase<Ring, Wait>::value_type;
+
+		bool pop(value_type& out_v)
+		{
+			return popOne([&out_v](value_type&& v) { out_v = std::move(v); });
+		}
+
+		std::optional<value_type> try_pop()
+		{
+			std::optional<value_type> res;
+			popOne([&res](value_type&& v) { res.emplace(std::move(v)); });
+			return res;
+		}
+
+		// blocks while the queue is empty
+		void pop_wait(value_type& out_v)
+		{
+			while (!pop(out_v))
+				this->m_notEmpty.wait([this]() { return this->published(this->m_readHead.load()); });
+		}
+
+		// waits up to timeout for a value
+		template <class Rep, class Period>
+		std::optional<value_type> try_pop_for(const std::chrono::duration<Rep, Period>& timeout)
+		{
+			std::optional<value_type> res = try_pop();
+			if (res)
+				return res;
+
+			const auto deadline = std::chrono::steady_clock::now() + timeout;
+			while (this->m_notEmpty.wait_until([this]() { return this->published(this->m_readHead.load()); }, deadline))
+			{
+				res = try_pop();
+				if (res)
+					break;
+			}
+			return res;
+		}
+
 		/*
-			taken from the book - C++ concurrency in action,
-			by Anthony Williams
-			section 7 Designing Lock-Free concurrent data structures, page 181
+			moves up to max items to out, the block is claimed with a single CAS on m_readHead.
+			returns how many were poped.
 		*/
-		class spinlock_mutex
+		template <typename OutIter>
+		size_t pop_n(OutIter out, size_t max)
 		{
-		public:
-			spinlock_mutex() = default;
-			~spinlock_mutex()
+			uint64_t ind{ 0 };
+			const size_t n = claim(ind, max);
+			if (n == 0)
+				return 0; // empty
+
+			for (uint64_t i = ind; i < ind + n; ++i)
 			{
-				unlock();
+				this->consume(i, [&out](value_type&& v) { *out++ = std::move(v); });
+				this->release(i);
 			}
 
-			void lock()
+			if constexpr (Mode != commitMode::perSlot)
 			{
-				while (m_flag.test_and_set(std::memory_order_acquire));
+				while (this->m_readTail.load() != ind);
+				this->m_readTail.fetch_add(n);
 			}
-			void unlock()
+
+			this->m_notFull.notify();
+			return n;
+		}
+
+	private:
+		template <typename F>
+		bool popOne(F&& f)
+		{
+			uint64_t ind{ 0 };
+			if (claim(ind, 1) == 0)
+				return false; // empty
+
+			// many threads read in paralel
+			this->consume(ind, std::forward<F>(f));
+
+			if constexpr (Mode == commitMode::perSlot)
 			{
-				m_flag.clear(std::memory_order_release);
+				// the slot goes back to the producers on its own, no need to wait for the other consumers
+				this->release(ind);
+			}
+			else
+			{
+				while (this->m_readTail.load() != ind);
+				++this->m_readTail;
 			}
 
-		private:
-			std::atomic_flag m_flag{ ATOMIC_FLAG_INIT };
-		};
-
-	public:
-		m2mQueue() = default;
-		~m2mQueue() = default;
+			this->m_notFull.notify();
+			return true;
+		}
 
-		bool pop(T& out_v)
+		/*
+			consumers race on m_readHead with CAS, the winner owns [ind, ind + n).
+			it used to be a spinlock around the check and the fetch_add.
+		*/
+		size_t claim(uint64_t& ind, size_t max)
 		{
-			uint64_t ind{ 0 };
+			ind = this->m_readHead.load();
+			while (true)
 			{
-				// tried with RAII std::lock_guard and my own lock
-				// performance drops drastically 
-				m_mtx.lock(); // spin lock
-				if (this->m_readHead.load() < this->m_writeTail.load())
+				const size_t n = this->publishedCount(ind, max);
+				if (n == 0)
 				{
-					ind = this->m_readHead.fetch_add(1);
-					m_mtx.unlock();
-				}
-				else
-				{
-					m_mtx.unlock();
-					return false; // empty
+					// ind can be stale, another consumer moved the cursor since it was read
+					const uint64_t current = this->m_readHead.load();
+					if (current == ind)
+						return 0; // empty, or the producer of ind didn't publish yet
+					ind = current;
+					continue;
 				}
+
+				if (this->m_readHead.compare_exchange_weak(ind, ind + n))
+					return n;
 			}
+		}
+	};
 
-			// many threads read in paralel
-			out_v = std::move(this->m_ringBuffer[ind % this->sizeofArr()]);
 
-			while (this->m_readTail.load() != ind);
-			++this->m_readTail;
+	/*
+		Many producers to One consumer queue
 
-			return true;
-		}
+		N - queue size
+		ThreadNum - max number of threads using Q
+		Mode - how producers commit, see commitMode
+		Wait - how the blocking calls wait, see waitStrategy.h
+	*/
+	template <class T, size_t N, size_t ThreadNum, commitMode Mode = commitMode::ordered, class Wait = pauseWait>
+	class m2oQueue : public m2oQueueBase<fixedRing<T, N, ThreadNum, Mode>, Wait>
+	{
+	public:
+		m2oQueue() {}
+		~m2oQueue() {}
+	};
 
-	private:
+	/*
+		Many producers to One consumer queue, sized at runtime and kept on the heap
+
+		capacity - queue size, at least, see heapRing
+		threadNum - max number of threads using Q
+	*/
+	template <class T, commitMode Mode = commitMode::ordered, class Wait = pauseWait>
+	class m2oHeapQueue : public m2oQueueBase<heapRing<T, Mode>, Wait>
+	{
+	public:
+		m2oHeapQueue(size_t capacity, size_t threadNum) : m2oQueueBase<heapRing<T, Mode>, Wait>(capacity, threadNum) {}
+		~m2oHeapQueue() {}
+	};
+
+	/*
+		Many producers to Many consumers queue
 
-		spinlock_mutex m_mtx;
+		N - queue size
+		ThreadNum - max number of threads using Q
+		Mode - how producers commit, see commitMode
+		Wait - how the blocking calls wait, see waitStrategy.h
+	*/
+	template <class T, size_t N, size_t ThreadNum, commitMode Mode = commitMode::perSlot, class Wait = pauseWait>
+	class m2mQueue : public m2mQueueBase<fixedRing<T, N, ThreadNum, Mode>, Wait>
+	{
+	public:
+		m2mQueue() = default;
+		~m2mQueue() = default;
+	};
+
+	/*
+		Many producers to Many consumers queue, sized at runtime and kept on the heap
+
+		capacity - queue size, at least, see heapRing
+		threadNum - max number of threads using Q
+	*/
+	template <class T, commitMode Mode = commitMode::perSlot, class Wait = pauseWait>
+	class m2mHeapQueue : public m2mQueueBase<heapRing<T, Mode>, Wait>
+	{
+	public:
+		m2mHeapQueue(size_t capacity, size_t threadNum) : m2mQueueBase<heapRing<T, Mode>, Wait>(capacity, threadNum) {}
+		~m2mHeapQueue() = default;
 	};
 
 };
\ No newline at end of file
@@ -1,12 +1,27 @@
 #pragma once
 
+#include "waitStrategy.h"
+
+#include <algorithm>
 #include <array>
 #include <memory>
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
 #include <immintrin.h> // For _mm_pause on x86
+#include <new>
+#include <optional>
 #include <type_traits>
 #include <utility>
 
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace concurency_2026{
 
 struct alignas(64) SharedCnt
@@ -14,15 +29,190 @@ struct alignas(64) SharedCnt
     std::atomic<size_t> _cnt{0};
 };
 
+/*
+    where the ring of QueueSPSC lives
+        InlineBuffer    - inside the queue object (default)
+        AllocatedBuffer - its own allocation, placed according to MemoryOptions
+*/
 template<typename T, size_t N>
+struct InlineBuffer
+{
+    T& operator[](size_t ind_) { return _arr[ind_]; }
+    T* data() { return _arr.data(); }
+
+    std::array<T, N> _arr;
+};
+
+enum class HugePages
+{
+    no,          // 4K pages
+    transparent, // 2MB aligned and madvise(MADV_HUGEPAGE), the kernel may or may not back it with huge pages
+    hugetlb      // MAP_HUGETLB from the reserved pool, falls back to transparent when the pool is empty
+};
+
+struct MemoryOptions
+{
+    HugePages _hugePages{HugePages::no};
+    bool _prefault{false}; // touch every page at construction, the first pass doesn't page fault
+    bool _lock{false};     // mlock, the pages are never swapped out, needs RLIMIT_MEMLOCK or CAP_IPC_LOCK
+};
+
+/*
+    the ring of QueueSPSC in its own memory, the options are requests, hugePages()/locked()/lockError() tell what it got.
+    a T that isn't trivially default constructible is constructed in every slot up front, that writes every page
+    whether or not _prefault is set.
+*/
+
+template<typename T, size_t N>
+class AllocatedBuffer
+{
+    static constexpr size_t HugePageSize{2 * 1024 * 1024};
+
+    public:
+    explicit AllocatedBuffer(const MemoryOptions& opts_ = {})
+    {
+        allocate(opts_._hugePages);
+        // constructing the elements below touches every page anyway
+        if (opts_._prefault && std::is_trivially_default_constructible_v<T>)
+        {
+            // transparent huge pages are a hint, the range may still be 4K pages, only hugetlb is sure to be 2MB pages
+            const size_t pageSize{_hugePages == HugePages::hugetlb ? HugePageSize : smallPageSize()};
+            for (size_t off = 0 ; off < _bytes ; off += pageSize)
+            {
+                static_cast<volatile char*>(_mem)[off] = 0;
+            }
+        }
+#if defined(__linux__)
+        if (opts_._lock)
+        {
+            _locked = mlock(_mem, _bytes) == 0;
+            _lockError = _locked ? 0 : errno;
+        }
+#else
+        _lockError = opts_._lock ? ENOSYS : 0;
+#endif
+        for (size_t i = 0 ; i < N ; ++i)
+        {
+            new (elem(i)) T;
+        }
+    }
+    ~AllocatedBuffer()
+    {
+        for (size_t i = 0 ; i < N ; ++i)
+        {
+            std::launder(elem(i))->~T();
+        }
+#if defined(__linux__)
+        if (_locked)
+        {
+            munlock(_mem, _bytes);
+        }
+        if (_mapped)
+        {
+            munmap(_mem, _bytes);
+            return;
+        }
+#endif
+        ::operator delete(_mem, std::align_val_t{Alignment});
+    }
+    AllocatedBuffer(const AllocatedBuffer&) = delete;
+    AllocatedBuffer& operator=(const AllocatedBuffer&) = delete;
+
+    T& operator[](size_t ind_) { return *std::launder(elem(ind_)); }
+    T* data() { return std::launder(elem(0)); }
+
+    // what the buffer really got, the options may fall back
+    HugePages hugePages() const { return _hugePages; }
+    bool locked() const { return _locked; }
+    // the errno of a failed mlock (ENOMEM over RLIMIT_MEMLOCK, EPERM), 0 when locked or not asked to
+    int lockError() const { return _lockError; }
+
+    private:
+    static constexpr size_t Alignment{alignof(T) > 64 ? alignof(T) : 64};
+
+    T* elem(size_t ind_) { return static_cast<T*>(_mem) + ind_; }
+
+    static size_t smallPageSize()
+    {
+#if defined(__linux__)
+        return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+        return 4096;
+#endif
+    }
+    static size_t roundUp(size_t bytes_, size_t to_)
+    {
+        return (bytes_ + to_ - 1) / to_ * to_;
+    }
+
+    void allocate(HugePages hugePages_)
+    {
+#if defined(__linux__)
+        if (hugePages_ == HugePages::hugetlb)
+        {
+            _bytes = roundUp(sizeof(T) * N, HugePageSize);
+            _mem = mmap(nullptr, _bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (_mem != MAP_FAILED)
+            {
+                _mapped = true;
+                _hugePages = HugePages::hugetlb;
+                return;
+            }
+            hugePages_ = HugePages::transparent;
+        }
+        if (hugePages_ == HugePages::transparent)
+        {
+            // over map by a huge page to cut a 2MB aligned range out of it
+            _bytes = roundUp(sizeof(T) * N, HugePageSize);
+            void* mem{mmap(nullptr, _bytes + HugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)};
+            if (mem == MAP_FAILED)
+            {
+                throw std::bad_alloc{};
+            }
+            char* begin{static_cast<char*>(mem)};
+            char* aligned{reinterpret_cast<char*>(roundUp(reinterpret_cast<uintptr_t>(begin), HugePageSize))};
+            if (aligned != begin)
+            {
+                munmap(begin, static_cast<size_t>(aligned - begin));
+            }
+            munmap(aligned + _bytes, static_cast<size_t>(begin + HugePageSize - aligned));
+            madvise(aligned, _bytes, MADV_HUGEPAGE);
+
+            _mem = aligned;
+            _mapped = true;
+            _hugePages = HugePages::transparent;
+            return;
+        }
+#endif
+        _bytes = roundUp(sizeof(T) * N, Alignment);
+        _mem = ::operator new(_bytes, std::align_val_t{Alignment});
+        _hugePages = HugePages::no;
+    }
+
+    void* _mem{nullptr};
+    size_t _bytes{0};
+    bool _mapped{false};
+    bool _locked{false};
+    int _lockError{0};
+    HugePages _hugePages{HugePages::no};
+};
+
+/*
+    Wait   - how push/pop wait while the queue is full/empty, see waitStrategy.h
+    Buffer - where the ring lives, InlineBuffer or AllocatedBuffer (constructed with MemoryOptions)
+*/
+template<typename T, size_t N, typename Wait = concurency::pauseWait, template<typename, size_t> class Buffer = InlineBuffer>
 class QueueSPSC
 {
     static_assert((N > 0) && ((N & (N - 1)) == 0), "N must be a power of 2");
 
     public:   
     QueueSPSC() = default;
+    explicit QueueSPSC(const MemoryOptions& opts_) : _arr{opts_} {}
     ~QueueSPSC() = default;
 
+    const Buffer<T, N>& buffer() const { return _arr; }
+
     bool empty() const
     {
         const auto head{_head.load(std::memory_order_relaxed)};
@@ -32,86 +222,300 @@ class QueueSPSC
 
     template <typename U, typename = std::enable_if_t<std::is_assignable_v<T&, U&&>>>
     void push(U&& elem_)
+    {
+        reserve() = std::forward<U>(elem_);
+        commit();
+    }
+
+    /*
+        zero copy producer side: reserve() waits for a free slot and returns it,
+        the element is filled in place and commit() publishes it.
+        every reserve() must be followed by one commit() before the next reserve()/push().
+    */
+    T& reserve()
     {
         const auto head{_head.load(std::memory_order_relaxed)};
 
-        while (head - _tail.load(std::memory_order_acquire) == N)
+        if (head - _tailCache == N)
         {
-            // full
-            _mm_pause();
+            // looks full, only now read the consumer's line
+            _notFull.wait([this, head](){
+                _tailCache = _tail.load(std::memory_order_acquire);
+                return head - _tailCache != N;
+            });
         }
-
-        _arr[head & (N - 1)] = std::forward<U>(elem_);
-
-        _head.store(head + 1, std::memory_order_release);
+        return _arr[head & (N - 1)];
+    }
+    void commit()
+    {
+        _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        _notEmpty.notify();
     }
 
     void pop(T& elem_)
     {
         const auto tail{_tail.load(std::memory_order_relaxed)};
-        while (tail == _head.load(std::memory_order_acquire))
+        if (tail == _headCache)
         {
-            // empty
-            _mm_pause();
+            // looks empty, only now read the producer's line
+            _notEmpty.wait([this, tail](){ return tail != refreshHeadCache(); });
         }
         
         elem_ = std::move(_arr[tail & (N - 1)]);
         _tail.store(tail + 1, std::memory_order_release);
+        _notFull.notify();
+    }
+
+    /*
+        zero copy consumer side: peek() returns the oldest element or nullptr when empty,
+        it stays in the queue until release().
+        every non null peek() must be followed by one release() before the next peek()/pop().
+    */
+    const T* peek()
+    {
+        const auto tail{_tail.load(std::memory_order_relaxed)};
+        if (tail == _headCache && tail == refreshHeadCache())
+        {
+            return nullptr;
+        }
+        return &_arr[tail & (N - 1)];
+    }
+    void release()
+    {
+        _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        _notFull.notify();
+    }
+
+    /*
+        bulk copy for trivially copyable types, doesn't wait.
+        copies up to n_ elements as at most two memcpy spans (the second one when the ring wraps)
+        and publishes them with one index store, returns how many were copied.
+    */
+    template <typename U = T, typename = std::enable_if_t<std::is_trivially_copyable_v<U>>>
+    size_t push_bulk(const T* elems_, size_t n_)
+    {
+        const auto head{_head.load(std::memory_order_relaxed)};
+        if (N - (head - _tailCache) < n_)
+        {
+            _tailCache = _tail.load(std::memory_order_acquire);
+        }
+        const size_t n{std::min(n_, N - (head - _tailCache))};
+        if (n == 0)
+        {
+            return 0;
+        }
+
+        const size_t start{head & (N - 1)};
+        const size_t first{std::min(n, N - start)};
+        std::memcpy(_arr.data() + start, elems_, first * sizeof(T));
+        std::memcpy(_arr.data(), elems_ + first, (n - first) * sizeof(T));
+
+        _head.store(head + n, std::memory_order_release);
+        _notEmpty.notify();
+        return n;
+    }
+    template <typename U = T, typename = std::enable_if_t<std::is_trivially_copyable_v<U>>>
+    size_t pop_bulk(T* elems_, size_t n_)
+    {
+        const auto tail{_tail.load(std::memory_order_relaxed)};
+        if (_headCache - tail < n_)
+        {
+            refreshHeadCache();
+        }
+        const size_t n{std::min(n_, _headCache - tail)};
+        if (n == 0)
+        {
+            return 0;
+        }
+
+        const size_t start{tail & (N - 1)};
+        const size_t first{std::min(n, N - start)};
+        std::memcpy(elems_, _arr.data() + start, first * sizeof(T));
+        std::memcpy(elems_ + first, _arr.data(), (n - first) * sizeof(T));
+
+        _tail.store(tail + n, std::memory_order_release);
+        _notFull.notify();
+        return n;
+    }
+
+    // waits up to timeout for an element
+    template <class Rep, class Period>
+    std::optional<T> try_pop_for(const std::chrono::duration<Rep, Period>& timeout_)
+    {
+        const auto tail{_tail.load(std::memory_order_relaxed)};
+        if (tail == _headCache && tail == refreshHeadCache())
+        {
+            const auto deadline{std::chrono::steady_clock::now() + timeout_};
+            if (!_notEmpty.wait_until([this, tail](){ return tail != refreshHeadCache(); }, deadline))
+            {
+                return std::nullopt;
+            }
+        }
+
+        std::optional<T> elem{std::move(_arr[tail & (N - 1)])};
+        _tail.store(tail + 1, std::memory_order_release);
+        _notFull.notify();
+        return elem;
     }
 
     private:
+    size_t refreshHeadCache()
+    {
+        _headCache = _head.load(std::memory_order_acquire);
+        return _headCache;
+    }
+
+    /*
+        each side keeps a private copy of the other side's index on its own line,
+        the other side's line is read only when the copy says full/empty.
+    */
     alignas(64) std::atomic<size_t> _head{0};
+    size_t _tailCache{0}; // the producer's copy of _tail
     alignas(64) std::atomic<size_t> _tail{0};
-    alignas(64) std::array<T, N> _arr;
+    size_t _headCache{0}; // the consumer's copy of _head
+    alignas(64) Buffer<T, N> _arr;
+    Wait _notEmpty; // the consumer waits on it
+    Wait _notFull; // the producer waits on it
 };
 
-#if 0
-template<typename T, size_t N>
+/*
+    many producers, one consumer.
+
+    every slot has a sequence number, for the slot of index i:
+        _seq == i       - free, the producer that wins the CAS of _head from i writes it
+        _seq == i + 1   - written, the consumer reads it and sets _seq to i + N for the next lap
+    producers don't wait for each other, the consumer waits only on the slot it reads.
+
+    Wait - how push/pop wait while the queue is full/empty, see waitStrategy.h
+*/
+template<typename T, size_t N, typename Wait = concurency::pauseWait>
 class QueueMPSC
 {
+    static_assert((N > 0) && ((N & (N - 1)) == 0), "N must be a power of 2");
+
     public:   
-    QueueMPSC() = default;
+    QueueMPSC()
+    {
+        for (size_t i = 0 ; i < N ; ++i)
+        {
+            _slots[i]._seq.store(i, std::memory_order_relaxed);
+        }
+    }
     ~QueueMPSC() = default;
 
     bool empty() const
     {
-        const auto head{_head._cnt.load(std::memory_order_relaxed)};
-        const auto tail{_tail._cnt.load(std::memory_order_acquire)};
-        return head == tail;
+        const auto tail{_tail._cnt.load(std::memory_order_relaxed)};
+        return _slots[tail & (N - 1)]._seq.load(std::memory_order_acquire) != tail + 1;
+    }
+
+    template <typename U, typename = std::enable_if_t<std::is_assignable_v<T&, U&&>>>
+    bool try_push(U&& elem_)
+    {
+        auto head{_head._cnt.load(std::memory_order_relaxed)};
+        while (true)
+        {
+            auto& slot{_slots[head & (N - 1)]};
+            const auto seq{slot._seq.load(std::memory_order_acquire)};
+            const auto diff{static_cast<std::ptrdiff_t>(seq - head)};
+            if (diff == 0)
+            {
+                // the slot is free for this lap, claim it
+                if (_head._cnt.compare_exchange_weak(head, head + 1, std::memory_order_relaxed))
+                {
+                    slot._elem = std::forward<U>(elem_);
+                    slot._seq.store(head + 1, std::memory_order_release);
+                    _notEmpty.notify();
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                // full, the consumer didn't free the slot of the previous lap yet
+                return false;
+            }
+            else
+            {
+                // another producer claimed head
+                head = _head._cnt.load(std::memory_order_relaxed);
+            }
+        }
     }
 
-    void push(const T& elem_)
+    template <typename U, typename = std::enable_if_t<std::is_assignable_v<T&, U&&>>>
+    void push(U&& elem_)
     {
-        const auto writeInd{_head._cnt.load(std::memory_order_relaxed)};
-        const auto nextInd{(writeInd + 1) % N};
-        while (nextInd == _tail._cnt.load(std::memory_order_acquire))
+        // try_push doesn't touch elem_ when it fails
+        while (!try_push(std::forward<U>(elem_)))
         {
-            // full
-            _mm_pause();
+            _notFull.wait([this](){ return !full(); });
         }
+    }
 
-        _arr[writeInd] = elem_;
+    bool try_pop(T& elem_)
+    {
+        const auto tail{_tail._cnt.load(std::memory_order_relaxed)};
+        auto& slot{_slots[tail & (N - 1)]};
+        if (slot._seq.load(std::memory_order_acquire) != tail + 1)
+        {
+            // empty, or the producer of tail didn't finish writing
+            return false;
+        }
 
-        _head._cnt.store(nextInd, std::memory_order_release);
+        elem_ = std::move(slot._elem);
+        slot._seq.store(tail + N, std::memory_order_release);
+        _tail._cnt.store(tail + 1, std::memory_order_relaxed);
+        _notFull.notify();
+        return true;
     }
 
     void pop(T& elem_)
     {
-        const auto readInd{_tail._cnt.load(std::memory_order_relaxed)};
-        while (readInd == _head._cnt.load(std::memory_order_acquire))
+        while (!try_pop(elem_))
         {
-            // empty
-            _mm_pause();
+            _notEmpty.wait([this](){ return !empty(); });
         }
-        
-        elem_ = _arr[readInd % N];
-        _tail._cnt.store((readInd + 1) % N, std::memory_order_release);
+    }
+
+    // waits up to timeout for an element
+    template <class Rep, class Period>
+    std::optional<T> try_pop_for(const std::chrono::duration<Rep, Period>& timeout_)
+    {
+        std::optional<T> elem{std::in_place};
+        if (try_pop(*elem))
+        {
+            return elem;
+        }
+
+        const auto deadline{std::chrono::steady_clock::now() + timeout_};
+        while (_notEmpty.wait_until([this](){ return !empty(); }, deadline))
+        {
+            if (try_pop(*elem))
+            {
+                return elem;
+            }
+        }
+        return std::nullopt;
     }
 
     private:
-    SharedCnt _head{0};
-    SharedCnt _tail{0};
-    std::array<T, N> _arr;
+    bool full() const
+    {
+        const auto head{_head._cnt.load(std::memory_order_relaxed)};
+        const auto seq{_slots[head & (N - 1)]._seq.load(std::memory_order_acquire)};
+        return static_cast<std::ptrdiff_t>(seq - head) < 0;
+    }
+
+    struct Slot
+    {
+        std::atomic<size_t> _seq{0};
+        T _elem;
+    };
+
+    SharedCnt _head;
+    SharedCnt _tail;
+    alignas(64) std::array<Slot, N> _slots;
+    Wait _notEmpty; // the consumer waits on it
+    Wait _notFull; // the producers wait on it
 };
-#endif
 }
\ No newline at end of file
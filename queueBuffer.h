@@ -1,7 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <cstring>
 #include <cstdint>
+#include <tuple>
 #include <utility>
 #include <string>
 #include <cmath>
@@ -10,25 +12,91 @@
 #include <ostream>
 #include <iostream>
 #include <mutex>
+#include <vector>
+#include <new>
+#include <memory>
+#include <type_traits>
 
-class bufferQueue
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h> // For _mm_stream_si128, _mm_sfence, _mm_prefetch on x86
+#define BUFFER_QUEUE_X86
+#endif
+
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <stdexcept>
+#include <system_error>
+#include <unistd.h>
+#endif
+
+/*
+    how the ring of a bufferQueue is backed
+        heap     - one allocation, a record that wraps is split at the end of the buffer
+        mirrored - the same memfd pages mapped twice back to back, every record is contiguous in memory,
+                   falls back to heap when the mapping fails (or on platforms without memfd)
+*/
+enum class bufferMapping
 {
-    friend std::ostream& operator<< (std::ostream& stream, const bufferQueue& obj);
-    class bufferQueueSyncMPSC;
-    friend std::ostream& operator<< (std::ostream& stream, const bufferQueueSyncMPSC& obj);
+    heap,
+    mirrored
+};
 
+/*
+    the record header of a bufferQueue and the block records are rounded up to, chosen at compile time
+        wideFraming    - 64 bit magic and 64 bit length in 16 bytes blocks, bufferQueue,
+                         the lock-free queues, the journal and the shared memory queue are built on it
+        compactFraming - one 32 bit word, 4 bits of magic and a 28 bits length (records up to 256MB) in 8 bytes blocks,
+                         bufferQueueCompact, a 20 bytes record takes 24 bytes of the ring instead of 48
+*/
+struct wideFraming
+{
     struct header
     {
         constexpr static uint64_t MagicValue{0xbadbabe};
         header(uint64_t len): _magic{MagicValue}, _len{len} {}
         bool verifyMagic() const noexcept {return _magic == MagicValue;}
+        size_t length() const noexcept {return _len;}
+        static bool fits(size_t /*len*/) noexcept {return true;}
         uint64_t _magic;
         uint64_t _len;
     };
     constexpr static size_t BlockSize{sizeof(header)};
+};
+struct compactFraming
+{
+    struct header
+    {
+        constexpr static uint32_t MagicValue{0xa};
+        constexpr static uint32_t LenBits{28};
+        constexpr static uint32_t LenMask{(uint32_t{1} << LenBits) - 1};
+        header(size_t len): _word{(MagicValue << LenBits) | static_cast<uint32_t>(len)} {}
+        bool verifyMagic() const noexcept {return (_word >> LenBits) == MagicValue;}
+        size_t length() const noexcept {return _word & LenMask;}
+        static bool fits(size_t len) noexcept {return len <= LenMask;}
+        uint32_t _word;
+    };
+    constexpr static size_t BlockSize{8};
+};
+
+template<typename Framing>
+class basicBufferQueue
+{
+    template<typename F>
+    friend std::ostream& operator<< (std::ostream& stream, const basicBufferQueue<F>& obj);
+
+    protected:
+    using header = typename Framing::header;
+    constexpr static size_t BlockSize{Framing::BlockSize};
+    static_assert(sizeof(header) <= BlockSize && BlockSize % alignof(header) == 0, "a header is at the start of a block");
+    // off by default, the crossover depends on the machine and on where the consumer runs
+    constexpr static size_t DefaultNonTemporalThreshold{SIZE_MAX};
 
     public:
-    bufferQueue(size_t capacity)
+    basicBufferQueue(size_t capacity, bufferMapping mapping = bufferMapping::heap)
     : _head{0}, _tail{0}
     {
         size_t powerOfTwo{1};
@@ -37,51 +105,191 @@ class bufferQueue
             powerOfTwo <<= 1;
         }
         _capacity = powerOfTwo;
-        _buffer = new char [_capacity];
-        std::memset(_buffer, 0, _capacity);
+        if (mapping == bufferMapping::mirrored)
+        {
+            mapMirrored();
+        }
+        if (_buffer == nullptr)
+        {
+            _buffer = new char [_capacity];
+            std::memset(_buffer, 0, _capacity);
+        }
         _capacityBlocks = _capacity / BlockSize;
     }
-    bufferQueue(const bufferQueue&) = delete;
-    bufferQueue& operator=(const bufferQueue&) = delete;
-    virtual ~bufferQueue() = default;
+    basicBufferQueue(const basicBufferQueue&) = delete;
+    basicBufferQueue& operator=(const basicBufferQueue&) = delete;
+    virtual ~basicBufferQueue()
+    {
+        if (_external)
+        {
+            return;
+        }
+#if defined(__linux__)
+        if (_mirrored)
+        {
+            munmap(_buffer, 2 * _capacity);
+            return;
+        }
+#endif
+        delete [] _buffer;
+    }
+
+    // false when the mirrored mapping was asked for and failed
+    bool mirrored() const noexcept {return _mirrored;}
+
+    /*
+        the writable payload of a reserved record, _second is set when the record wraps around the end of _buffer
+    */
+    struct spans
+    {
+        std::pair<char*, size_t> _first{nullptr, 0};
+        std::pair<char*, size_t> _second{nullptr, 0};
+
+        bool valid() const noexcept {return _first.first != nullptr;}
+    };
 
     bool push(const char* ptrIn, size_t len)
+    {
+        const auto s{reserve(len)};
+        if (!s.valid())
+        {
+            return false;
+        }
+        copyIn(s, ptrIn, len);
+        commit();
+        return true;
+    }
+
+    /*
+        payloads of at least threshold bytes are copied with non-temporal (streaming) stores,
+        they go to memory without pulling the ring's lines into the producer's cache.
+        0 streams every payload, SIZE_MAX none, see testNonTemporal in tests/test_queueBuffer.cpp for the crossover.
+        it applies to push, push_batch and the scatter-gather push of this class, the queues built on it
+        (MPSC, SPMC, Shm, Multicast, ...) don't expose it and always copy with memcpy.
+    */
+    void setNonTemporalThreshold(size_t threshold) noexcept {_nonTemporalThreshold = threshold;}
+
+    // the longest payload that fits in the empty queue, push() of a longer one always fails
+    size_t maxPayload() const noexcept {return (_capacityBlocks - 1) * BlockSize - sizeof(header);}
+
+    /*
+        scatter-gather push: one record made of count fragments (pointer, length), copied in order into one reservation
+    */
+    bool push(const std::pair<const char*, size_t>* fragments, size_t count)
+    {
+        return pushFragments(fragments, count);
+    }
+#if defined(__linux__)
+    bool push(const iovec* fragments, size_t count)
+    {
+        return pushFragments(fragments, count);
+    }
+#endif
+
+    /*
+        zero copy push: reserve(len) returns the spans of a len bytes record inside the ring (not valid when there is no room),
+        the caller writes the payload into them and commit() publishes the record.
+        one record at a time, every valid reserve() must be followed by commit() before the next reserve()/push().
+    */
+    spans reserve(size_t len)
     {
         const auto headVal{_head.load(std::memory_order_relaxed)};
         const auto tailVal{_tail.load(std::memory_order_acquire)};
 
-        const auto [blocksAhead, blocksOverlap] = toWriteBlocks(headVal, tailVal, _capacityBlocks);
-        const auto blocksNeeded{numOfBlocks(len + sizeof(header))};
-        if (blocksAhead + blocksOverlap < blocksNeeded)
+        const auto s{reserveAt(headVal, tailVal, len)};
+        if (s.valid())
         {
-            return false;
+            _reservedBlocks = numOfBlocks(len + sizeof(header));
         }
+        return s;
+    }
+    void commit()
+    {
+        const auto headVal{_head.load(std::memory_order_relaxed)};
+        fenceStreamed();
+        _head.store((headVal + _reservedBlocks) % _capacityBlocks, std::memory_order_release);
+        _reservedBlocks = 0;
+    }
 
-        auto* ptr{_buffer + headVal * BlockSize};
-        new (ptr) header{len};
-        ptr += sizeof(header);
+    /*
+        writes records (pointer, length) in order while they fit and publishes them all with one store of _head,
+        returns how many were written.
+    */
+    size_t push_batch(const std::pair<const char*, size_t>* records, size_t count)
+    {
+        auto headVal{_head.load(std::memory_order_relaxed)};
+        const auto tailVal{_tail.load(std::memory_order_acquire)};
 
-        if (blocksAhead >= blocksNeeded)
+        size_t pushed{0};
+        for (; pushed < count ; pushed++)
         {
-            std::memcpy(ptr, ptrIn, len);
+            const auto [ptrIn, len] = records[pushed];
+            const auto s{reserveAt(headVal, tailVal, len)};
+            if (!s.valid())
+            {
+                break;
+            }
+            copyIn(s, ptrIn, len);
+            headVal = (headVal + numOfBlocks(len + sizeof(header))) % _capacityBlocks;
         }
-        else
+
+        if (pushed > 0)
         {
-            const auto bufferAheadLen{blocksAhead * BlockSize - sizeof(header)};
-            std::memcpy(ptr, ptrIn, bufferAheadLen);
-            ptr = _buffer;
-            const auto bufferOverlapLen{len - bufferAheadLen};
-            std::memcpy(ptr, ptrIn + bufferAheadLen, bufferOverlapLen);
+            fenceStreamed();
+            _head.store(headVal, std::memory_order_release);
         }
+        return pushed;
+    }
 
-        _head.store((headVal + blocksNeeded) % _capacityBlocks, std::memory_order_release);
-   
-        return true;
+    /*
+        calls callback(const char* ptr, size_t len) for up to maxRecords records that are in the queue,
+        in one pass and with one store of _tail at the end, returns how many were consumed.
+        ptr is valid only inside the callback.
+    */
+    template<typename Callback>
+    size_t consume(Callback&& callback, size_t maxRecords = SIZE_MAX)
+    {
+        const auto headVal{_head.load(std::memory_order_acquire)};
+        auto tailVal{_tail.load(std::memory_order_relaxed)};
+
+        size_t consumed{0};
+        for (; consumed < maxRecords && !empty(headVal, tailVal) ; consumed++)
+        {
+            const auto* ptr{_buffer + tailVal * BlockSize};
+            const auto* headerPtr{reinterpret_cast<const header*>(ptr)};
+            assert(headerPtr->verifyMagic());
+            ptr += sizeof(header);
+
+            const auto len{headerPtr->length()};
+            const auto bufferAheadLen{(_capacityBlocks - tailVal) * BlockSize - sizeof(header)};
+            if (len <= bufferAheadLen || _mirrored)
+            {
+                callback(ptr, len);
+            }
+            else
+            {
+                _wrapBuffer.resize(len);
+                std::memcpy(_wrapBuffer.data(), ptr, bufferAheadLen);
+                std::memcpy(_wrapBuffer.data() + bufferAheadLen, _buffer, len - bufferAheadLen);
+                callback(static_cast<const char*>(_wrapBuffer.data()), len);
+            }
+            tailVal = (tailVal + numOfBlocks(len + sizeof(header))) % _capacityBlocks;
+            if (!empty(headVal, tailVal))
+            {
+                prefetch(_buffer + tailVal * BlockSize);
+            }
+        }
+
+        if (consumed > 0)
+        {
+            _tail.store(tailVal, std::memory_order_release);
+        }
+        return consumed;
     }
     std::pair<const char*, size_t> front(std::string& buffer)
     {
-        const auto headVal{_head.load(std::memory_order_relaxed)};
-        const auto tailVal{_tail.load(std::memory_order_acquire)};
+        const auto headVal{_head.load(std::memory_order_acquire)};
+        const auto tailVal{_tail.load(std::memory_order_relaxed)};
 
         if (empty(headVal, tailVal))
         {
@@ -98,27 +306,34 @@ class bufferQueue
         
         ptr += sizeof(header);
 
+        // the next record is most likely read right after this one
+        const auto nextVal{(tailVal + numOfBlocks(headerPtr->length() + sizeof(header))) % _capacityBlocks};
+        if (nextVal != headVal)
+        {
+            prefetch(_buffer + nextVal * BlockSize);
+        }
+
         const auto [blocksAhead, blocksOverlap] = toReadBlocks(headVal, tailVal, _capacityBlocks);
-        if (headerPtr->_len + sizeof(header) <= blocksAhead * BlockSize)
+        if (headerPtr->length() + sizeof(header) <= blocksAhead * BlockSize || _mirrored)
         {
-            return {ptr, headerPtr->_len};
+            return {ptr, headerPtr->length()};
         }
 
-        buffer.resize(headerPtr->_len);
+        buffer.resize(headerPtr->length());
         const auto bufferAheadLen{blocksAhead * BlockSize - sizeof(header)};
         std::memcpy(buffer.data(), ptr, bufferAheadLen);
         ptr = _buffer;
-        const auto bufferOverlapLen{headerPtr->_len - bufferAheadLen};
+        const auto bufferOverlapLen{headerPtr->length() - bufferAheadLen};
         std::memcpy(buffer.data() + bufferAheadLen, ptr, bufferOverlapLen);
 
-        assert(bufferOverlapLen + bufferAheadLen == headerPtr->_len);
+        assert(bufferOverlapLen + bufferAheadLen == headerPtr->length());
 
         return {buffer.c_str(), buffer.size()};
     }
     bool pop()
     {
-        const auto headVal{_head.load(std::memory_order_relaxed)};
-        const auto tailVal{_tail.load(std::memory_order_acquire)};
+        const auto headVal{_head.load(std::memory_order_acquire)};
+        const auto tailVal{_tail.load(std::memory_order_relaxed)};
 
         if (empty(headVal, tailVal))
         {
@@ -129,7 +344,7 @@ class bufferQueue
         const auto* headerPtr{reinterpret_cast<const header*>(ptr)};
         assert(headerPtr->verifyMagic());
 
-        const auto blocksToSkip{numOfBlocks(headerPtr->_len + sizeof(header))};
+        const auto blocksToSkip{numOfBlocks(headerPtr->length() + sizeof(header))};
 
         _tail.store((tailVal + blocksToSkip) % _capacityBlocks, std::memory_order_release);
 
@@ -138,8 +353,8 @@ class bufferQueue
 
     bool empty() const noexcept
     {
-        const auto headVal{_head.load(std::memory_order_relaxed)};
-        const auto tailVal{_tail.load(std::memory_order_acquire)};
+        const auto headVal{_head.load(std::memory_order_acquire)};
+        const auto tailVal{_tail.load(std::memory_order_relaxed)};
 
         return empty(headVal, tailVal);
     }
@@ -159,7 +374,12 @@ class bufferQueue
         return (headVal + 1) % capacityBlocks == tailVal;
     }
 
-    private:
+    protected:
+    // a ring in memory the derived class owns, capacity is a power of 2
+    basicBufferQueue(char* buffer, size_t capacity, size_t headVal, size_t tailVal)
+    : _head{headVal}, _tail{tailVal}, _buffer{buffer}, _capacity{capacity}, _capacityBlocks{capacity / BlockSize}, _external{true}
+    {}
+
     static std::pair<size_t, size_t> toWriteBlocks(size_t head, size_t tail, size_t capacityBlocks)
     {
         /*
@@ -198,16 +418,185 @@ class bufferQueue
     {
         return std::ceil(static_cast<double>(n) / static_cast<double>(BlockSize));
     }
+    static std::pair<const char*, size_t> fragment(const std::pair<const char*, size_t>& f) {return f;}
+#if defined(__linux__)
+    static std::pair<const char*, size_t> fragment(const iovec& f) {return {static_cast<const char*>(f.iov_base), f.iov_len};}
+#endif
+    template<typename Fragment>
+    bool pushFragments(const Fragment* fragments, size_t count)
+    {
+        size_t len{0};
+        for (size_t i = 0 ; i < count ; i++)
+        {
+            len += fragment(fragments[i]).second;
+        }
+        const auto s{reserve(len)};
+        if (!s.valid())
+        {
+            return false;
+        }
+
+        // a fragment may be split between the spans
+        const bool stream{len >= _nonTemporalThreshold};
+        auto [ptr, left] = s._first;
+        for (size_t i = 0 ; i < count ; i++)
+        {
+            auto [ptrIn, lenIn] = fragment(fragments[i]);
+            while (lenIn > 0)
+            {
+                if (left == 0)
+                {
+                    std::tie(ptr, left) = s._second;
+                }
+                const auto n{std::min(lenIn, left)};
+                if (stream)
+                {
+                    streamCopy(ptr, ptrIn, n);
+                }
+                else
+                {
+                    std::memcpy(ptr, ptrIn, n);
+                }
+                ptr += n;
+                left -= n;
+                ptrIn += n;
+                lenIn -= n;
+            }
+        }
+        _streamed = stream;
+        commit();
+        return true;
+    }
+    // copies a payload into the spans of its reservation, fenceStreamed() before the release of _head makes the stores visible
+    void copyIn(const spans& s, const char* ptrIn, size_t len)
+    {
+        if (len < _nonTemporalThreshold)
+        {
+            std::memcpy(s._first.first, ptrIn, s._first.second);
+            std::memcpy(s._second.first, ptrIn + s._first.second, s._second.second);
+            return;
+        }
+        streamCopy(s._first.first, ptrIn, s._first.second);
+        streamCopy(s._second.first, ptrIn + s._first.second, s._second.second);
+        _streamed = true;
+    }
+    // once per publish, not per record
+    void fenceStreamed()
+    {
+#if defined(BUFFER_QUEUE_X86)
+        if (_streamed)
+        {
+            // streaming stores are weakly ordered, the release of _head doesn't order them
+            _mm_sfence();
+        }
+#endif
+        _streamed = false;
+    }
+    static void streamCopy(char* dst, const char* src, size_t len)
+    {
+        size_t copied{0};
+#if defined(BUFFER_QUEUE_X86)
+        // the payload follows the header, 16 bytes aligned with wideFraming but not with compactFraming (block + 4),
+        // and a fragment can start anywhere: memcpy up to the next 16 bytes and stream from there
+        copied = std::min(len, (16 - reinterpret_cast<uintptr_t>(dst) % 16) % 16);
+        std::memcpy(dst, src, copied);
+        for (; copied + 16 <= len ; copied += 16)
+        {
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + copied), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + copied)));
+        }
+#endif
+        std::memcpy(dst + copied, src + copied, len - copied);
+    }
+    static void prefetch(const char* ptr)
+    {
+#if defined(BUFFER_QUEUE_X86)
+        _mm_prefetch(ptr, _MM_HINT_T0);
+#elif defined(__GNUC__)
+        __builtin_prefetch(ptr);
+#endif
+    }
+    // header fields that are shared between threads by the lock-free queues
+    static std::atomic<uint64_t>& asAtomic(uint64_t& field)
+    {
+        static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && std::atomic<uint64_t>::is_always_lock_free,
+                      "header fields are accessed as atomics in place");
+        return *reinterpret_cast<std::atomic<uint64_t>*>(&field);
+    }
+    // writes the header of a len bytes record at headVal, doesn't publish it
+    spans reserveAt(size_t headVal, size_t tailVal, size_t len)
+    {
+        const auto [blocksAhead, blocksOverlap] = toWriteBlocks(headVal, tailVal, _capacityBlocks);
+        const auto blocksNeeded{numOfBlocks(len + sizeof(header))};
+        if (blocksAhead + blocksOverlap < blocksNeeded || !header::fits(len))
+        {
+            return {};
+        }
+
+        auto* ptr{_buffer + headVal * BlockSize};
+        new (ptr) header{len};
+        ptr += sizeof(header);
+
+        if (blocksAhead >= blocksNeeded || _mirrored)
+        {
+            return {{ptr, len}, {_buffer, 0}};
+        }
+        const auto bufferAheadLen{blocksAhead * BlockSize - sizeof(header)};
+        return {{ptr, bufferAheadLen}, {_buffer, len - bufferAheadLen}};
+    }
+    void mapMirrored()
+    {
+#if defined(__linux__)
+        // the mappings are in whole pages
+        _capacity = std::max(_capacity, static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+
+        const int fd{memfd_create("bufferQueue", MFD_CLOEXEC)};
+        if (fd < 0)
+        {
+            return;
+        }
+        if (ftruncate(fd, static_cast<off_t>(_capacity)) != 0)
+        {
+            close(fd);
+            return;
+        }
+        // reserve both halves in one range, then map the file over each of them
+        void* range{mmap(nullptr, 2 * _capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)};
+        if (range == MAP_FAILED)
+        {
+            close(fd);
+            return;
+        }
+        char* ptr{static_cast<char*>(range)};
+        if (mmap(ptr, _capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+            mmap(ptr + _capacity, _capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+        {
+            munmap(range, 2 * _capacity);
+            close(fd);
+            return;
+        }
+        // the mappings keep the file alive
+        close(fd);
+        _buffer = ptr;
+        _mirrored = true;
+#endif
+    }
    
     protected:
     std::atomic<size_t> _head;
     std::atomic<size_t> _tail;
-    char* _buffer;
+    char* _buffer{nullptr};
     size_t _capacity;
     size_t _capacityBlocks;
+    size_t _reservedBlocks{0}; // the producer's record between reserve() and commit()
+    bool _mirrored{false};     // _buffer is followed by a second mapping of itself
+    bool _external{false};     // _buffer isn't freed by bufferQueue
+    std::string _wrapBuffer;   // the consumer's copy of a wrapped record in consume()
+    size_t _nonTemporalThreshold{DefaultNonTemporalThreshold};
+    bool _streamed{false}; // copyIn() used streaming stores since the last publish
 };
 
-std::ostream& operator<< (std::ostream& stream, const bufferQueue& obj)
+template<typename Framing>
+std::ostream& operator<< (std::ostream& stream, const basicBufferQueue<Framing>& obj)
 {
     stream << "_head: " << obj._head << ", _tail: " << obj._tail
            << ", _capacity: " << obj._capacity 
@@ -215,6 +604,9 @@ std::ostream& operator<< (std::ostream& stream, const bufferQueue& obj)
     return stream;
 }
 
+using bufferQueue = basicBufferQueue<wideFraming>;
+using bufferQueueCompact = basicBufferQueue<compactFraming>;
+
 using bufferQueueSyncSPSC = bufferQueue;
 
 class bufferQueueSyncMPSC : protected bufferQueue
@@ -307,4 +699,1649 @@ std::ostream& operator<< (std::ostream& stream, const bufferQueueSyncMPMC& obj)
 {
     stream << static_cast<const bufferQueue&>(obj);
     return stream;
-}
\ No newline at end of file
+}
+
+/*
+    lock-free, many producers one consumer.
+
+    _head and _tail count blocks from the start and never wrap, the block index is % _capacityBlocks,
+    so a producer that slept through a whole lap fails its CAS instead of claiming the same range again.
+
+    push: a producer claims the blocks of a record with a CAS on _head, copies the payload
+          and commits the record by storing the header magic (release) last.
+          producers copy in parallel, a producer that commits late doesn't stop the others from claiming.
+    front/pop: the consumer reads the record at _tail once its magic is stored (acquire),
+          records are read in the order they were claimed.
+          pop zeroes the record before it releases the blocks, so stale payload bytes never look like a committed header.
+*/
+class bufferQueueMPSC : protected bufferQueue
+{
+    friend std::ostream& operator<< (std::ostream& stream, const bufferQueueMPSC& obj);
+
+    public:
+    bufferQueueMPSC(size_t capacity, bufferMapping mapping = bufferMapping::heap): bufferQueue{capacity, mapping} {}
+    using bufferQueue::mirrored;
+
+    bool push(const char* ptrIn, size_t len)
+    {
+        return push(_head, _tail, ptrIn, len, false);
+    }
+    std::pair<const char*, size_t> front(std::string& buffer)
+    {
+        return front(_head, _tail, buffer);
+    }
+    bool pop()
+    {
+        return pop(_head, _tail, true);
+    }
+
+    bool empty() const noexcept
+    {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_relaxed);
+    }
+
+    protected:
+    // a ring in memory the derived class owns
+    bufferQueueMPSC(char* buffer, size_t capacity): bufferQueue{buffer, capacity, 0, 0} {}
+
+    /*
+        the algorithm on any pair of cursors, bufferQueueShm keeps them in shared memory.
+        singleProducer - _head is advanced by a store after the record is written, no CAS,
+                         records are published by _head so pop doesn't need to zero them.
+    */
+    bool push(std::atomic<size_t>& head, std::atomic<size_t>& tail, const char* ptrIn, size_t len, bool singleProducer)
+    {
+        const auto blocksNeeded{numOfBlocks(len + sizeof(header))};
+        auto headVal{head.load(std::memory_order_relaxed)};
+        do
+        {
+            const auto tailVal{tail.load(std::memory_order_acquire)};
+            // keeps one block free like bufferQueue
+            if (_capacityBlocks - 1 - (headVal - tailVal) < blocksNeeded)
+            {
+                return false;
+            }
+        }
+        while (!singleProducer && !head.compare_exchange_weak(headVal, headVal + blocksNeeded, std::memory_order_relaxed, std::memory_order_relaxed));
+
+        const auto index{headVal % _capacityBlocks};
+        auto* headerPtr{reinterpret_cast<header*>(_buffer + index * BlockSize)};
+        auto* ptr{_buffer + index * BlockSize + sizeof(header)};
+
+        const auto bufferAheadLen{_mirrored ? len : std::min(len, (_capacityBlocks - index) * BlockSize - sizeof(header))};
+        std::memcpy(ptr, ptrIn, bufferAheadLen);
+        std::memcpy(_buffer, ptrIn + bufferAheadLen, len - bufferAheadLen);
+
+        headerPtr->_len = len;
+        asAtomic(headerPtr->_magic).store(header::MagicValue, std::memory_order_release);
+        if (singleProducer)
+        {
+            head.store(headVal + blocksNeeded, std::memory_order_release);
+        }
+        return true;
+    }
+    std::pair<const char*, size_t> front(std::atomic<size_t>& head, std::atomic<size_t>& tail, std::string& buffer)
+    {
+        const auto tailVal{tail.load(std::memory_order_relaxed)};
+        if (tailVal == head.load(std::memory_order_acquire))
+        {
+            return {nullptr, 0};
+        }
+
+        const auto index{tailVal % _capacityBlocks};
+        auto* headerPtr{reinterpret_cast<header*>(_buffer + index * BlockSize)};
+        if (asAtomic(headerPtr->_magic).load(std::memory_order_acquire) != header::MagicValue)
+        {
+            // claimed, not committed yet
+            return {nullptr, 0};
+        }
+        const auto* ptr{_buffer + index * BlockSize + sizeof(header)};
+
+        const auto bufferAheadLen{(_capacityBlocks - index) * BlockSize - sizeof(header)};
+        if (headerPtr->_len <= bufferAheadLen || _mirrored)
+        {
+            return {ptr, headerPtr->_len};
+        }
+
+        buffer.resize(headerPtr->_len);
+        std::memcpy(buffer.data(), ptr, bufferAheadLen);
+        std::memcpy(buffer.data() + bufferAheadLen, _buffer, headerPtr->_len - bufferAheadLen);
+        return {buffer.c_str(), buffer.size()};
+    }
+    bool pop(std::atomic<size_t>& head, std::atomic<size_t>& tail, bool zero)
+    {
+        const auto tailVal{tail.load(std::memory_order_relaxed)};
+        if (tailVal == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        const auto index{tailVal % _capacityBlocks};
+        auto* headerPtr{reinterpret_cast<header*>(_buffer + index * BlockSize)};
+        if (asAtomic(headerPtr->_magic).load(std::memory_order_acquire) != header::MagicValue)
+        {
+            return false;
+        }
+
+        const auto blocksToSkip{numOfBlocks(headerPtr->_len + sizeof(header))};
+        if (zero)
+        {
+            const auto blocksAhead{std::min(blocksToSkip, _capacityBlocks - index)};
+            std::memset(_buffer + index * BlockSize, 0, blocksAhead * BlockSize);
+            std::memset(_buffer, 0, (blocksToSkip - blocksAhead) * BlockSize);
+        }
+
+        tail.store(tailVal + blocksToSkip, std::memory_order_release);
+        return true;
+    }
+};
+
+std::ostream& operator<< (std::ostream& stream, const bufferQueueMPSC& obj)
+{
+    stream << static_cast<const bufferQueue&>(obj);
+    return stream;
+}
+
+/*
+    lock-free, one producer many consumers.
+
+    like bufferQueueMPSC the cursors count blocks from the start and never wrap.
+        _head     - the producer publishes records by advancing it
+        _tail     - consumers claim a whole record with a CAS on it
+        _released - the producer's own cursor, the start of the oldest record that is still in use
+    a consumer processes the record it claimed in place and then marks its header magic as ReleasedValue.
+    consumers finish in any order, the producer moves _released over released records only,
+    so it reuses space once all the earlier records are released.
+    consume() is the zero copy read, pop(buffer) copies every record and is there for code written against bufferQueueSyncSPMC.
+*/
+class bufferQueueSPMC : protected bufferQueue
+{
+    friend std::ostream& operator<< (std::ostream& stream, const bufferQueueSPMC& obj);
+
+    constexpr static uint64_t ReleasedValue{~header::MagicValue};
+
+    public:
+    bufferQueueSPMC(size_t capacity, bufferMapping mapping = bufferMapping::heap): bufferQueue{capacity, mapping} {}
+    using bufferQueue::mirrored;
+
+    bool push(const char* ptrIn, size_t len)
+    {
+        const auto headVal{_head.load(std::memory_order_relaxed)};
+        const auto blocksNeeded{numOfBlocks(len + sizeof(header))};
+        // keeps one block free like bufferQueue
+        if (_capacityBlocks - 1 - (headVal - _released) < blocksNeeded)
+        {
+            reclaim(headVal);
+            if (_capacityBlocks - 1 - (headVal - _released) < blocksNeeded)
+            {
+                return false;
+            }
+        }
+
+        const auto index{headVal % _capacityBlocks};
+        auto* headerPtr{reinterpret_cast<header*>(_buffer + index * BlockSize)};
+        auto* ptr{_buffer + index * BlockSize + sizeof(header)};
+
+        const auto bufferAheadLen{_mirrored ? len : std::min(len, (_capacityBlocks - index) * BlockSize - sizeof(header))};
+        std::memcpy(ptr, ptrIn, bufferAheadLen);
+        std::memcpy(_buffer, ptrIn + bufferAheadLen, len - bufferAheadLen);
+
+        // a consumer with a stale _tail may read the header, its CAS fails
+        asAtomic(headerPtr->_len).store(len, std::memory_order_relaxed);
+        asAtomic(headerPtr->_magic).store(header::MagicValue, std::memory_order_relaxed);
+        _head.store(headVal + blocksNeeded, std::memory_order_release);
+        return true;
+    }
+
+    /*
+        claims the oldest record and calls callback(const char* ptr, size_t len) on it in place,
+        false when the queue is empty.
+        buffer is used only for a record that wraps around the end of a heap buffer, ptr is valid only inside the callback.
+    */
+    template<typename Callback>
+    bool consume(Callback&& callback, std::string& buffer)
+    {
+        auto tailVal{_tail.load(std::memory_order_relaxed)};
+        size_t len{0};
+        do
+        {
+            if (tailVal == _head.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            len = asAtomic(headerAt(tailVal)->_len).load(std::memory_order_relaxed);
+        }
+        while (!_tail.compare_exchange_weak(tailVal, tailVal + numOfBlocks(len + sizeof(header)), std::memory_order_relaxed, std::memory_order_relaxed));
+
+        const auto index{tailVal % _capacityBlocks};
+        auto* headerPtr{headerAt(tailVal)};
+        assert(asAtomic(headerPtr->_magic).load(std::memory_order_relaxed) == header::MagicValue);
+        const auto* ptr{_buffer + index * BlockSize + sizeof(header)};
+
+        const auto bufferAheadLen{(_capacityBlocks - index) * BlockSize - sizeof(header)};
+        if (len <= bufferAheadLen || _mirrored)
+        {
+            callback(ptr, len);
+        }
+        else
+        {
+            buffer.resize(len);
+            std::memcpy(buffer.data(), ptr, bufferAheadLen);
+            std::memcpy(buffer.data() + bufferAheadLen, _buffer, len - bufferAheadLen);
+            callback(static_cast<const char*>(buffer.data()), len);
+        }
+
+        asAtomic(headerPtr->_magic).store(ReleasedValue, std::memory_order_release);
+        return true;
+    }
+
+    /*
+        the bufferQueueSyncSPMC interface, copies every record into buffer, contiguous ones too:
+        the record is released when pop returns and the producer may write over it, a pointer into the ring can't be returned.
+        use consume() to read in place.
+    */
+    std::pair<const char*, size_t> pop(std::string& buffer)
+    {
+        const bool res{consume([&buffer](const char* ptr, size_t len){
+            if (ptr != buffer.data())
+            {
+                buffer.assign(ptr, len);
+            }
+        }, buffer)};
+        if (!res)
+        {
+            return {nullptr, 0};
+        }
+        return {buffer.c_str(), buffer.size()};
+    }
+
+    bool empty() const noexcept
+    {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_relaxed);
+    }
+
+    private:
+    header* headerAt(size_t pos)
+    {
+        return reinterpret_cast<header*>(_buffer + (pos % _capacityBlocks) * BlockSize);
+    }
+    // moves _released over the records the consumers are done with
+    void reclaim(size_t headVal)
+    {
+        while (_released != headVal)
+        {
+            auto* headerPtr{headerAt(_released)};
+            if (asAtomic(headerPtr->_magic).load(std::memory_order_acquire) != ReleasedValue)
+            {
+                return;
+            }
+            _released += numOfBlocks(asAtomic(headerPtr->_len).load(std::memory_order_relaxed) + sizeof(header));
+        }
+    }
+
+    size_t _released{0};
+};
+
+std::ostream& operator<< (std::ostream& stream, const bufferQueueSPMC& obj)
+{
+    stream << static_cast<const bufferQueue&>(obj) << ", _released: " << obj._released;
+    return stream;
+}
+
+#if defined(__linux__)
+/*
+    a bufferQueue (one producer, one consumer) whose ring is a memory mapped file, it outlives the process.
+
+    the file is a control page followed by the ring:
+        control page - _head and _tail, the capacity and a magic that marks the file as initialized
+        ring         - the records, in the bufferQueueMPSC format
+    _head and _tail in the control page are the cursors themselves, like in bufferQueueShm, so a producer and
+    a consumer in different processes, or a consumer restarted next to a live producer, see each other's progress.
+    pages of a shared mapping belong to the kernel, a crash of the process loses nothing that was pushed.
+    sync() flushes them to the disk as well, for surviving a crash of the machine.
+
+    only a new (empty) file is initialized, opening a file that isn't a journal of this capacity throws.
+    opening an existing journal resumes it, the records between _tail and _head are validated in place
+    (magic and length) and _head is cut at the first one that is not whole.
+*/
+class bufferQueueJournal : protected bufferQueueMPSC
+{
+    friend std::ostream& operator<< (std::ostream& stream, const bufferQueueJournal& obj);
+
+    struct control
+    {
+        constexpr static uint64_t MagicValue{0x6a6f75726e616cULL}; // "journal"
+        uint64_t _magic;
+        uint64_t _capacity;
+        alignas(64) std::atomic<size_t> _head;
+        alignas(64) std::atomic<size_t> _tail;
+    };
+    constexpr static size_t ControlSize{4096};
+    static_assert(sizeof(control) <= ControlSize, "the control fits in its page");
+
+    public:
+    bufferQueueJournal(const std::string& path, size_t capacity)
+    : bufferQueueMPSC{nullptr, 0}
+    {
+        size_t powerOfTwo{ControlSize};
+        while(powerOfTwo <= capacity)
+        {
+            powerOfTwo <<= 1;
+        }
+        const size_t fileSize{ControlSize + powerOfTwo};
+
+        const int fd{open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)};
+        if (fd < 0)
+        {
+            throw std::system_error{errno, std::generic_category(), "bufferQueueJournal: open " + path};
+        }
+        struct stat st{};
+        if (fstat(fd, &st) != 0)
+        {
+            const int err{errno};
+            close(fd);
+            throw std::system_error{err, std::generic_category(), "bufferQueueJournal: fstat " + path};
+        }
+        // only a file this call created is initialized, anything else has to be a journal already
+        const bool created{st.st_size == 0};
+        if (!created && static_cast<size_t>(st.st_size) != fileSize)
+        {
+            close(fd);
+            throw std::runtime_error{"bufferQueueJournal: " + path + " has " + std::to_string(st.st_size) + " bytes, expected " + std::to_string(fileSize)};
+        }
+        if (created && ftruncate(fd, static_cast<off_t>(fileSize)) != 0)
+        {
+            const int err{errno};
+            close(fd);
+            throw std::system_error{err, std::generic_category(), "bufferQueueJournal: ftruncate " + path};
+        }
+        void* mem{mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)};
+        const int err{errno};
+        // the mapping keeps the file open
+        close(fd);
+        if (mem == MAP_FAILED)
+        {
+            throw std::system_error{err, std::generic_category(), "bufferQueueJournal: mmap " + path};
+        }
+
+        _mem = static_cast<char*>(mem);
+        _fileSize = fileSize;
+        _control = reinterpret_cast<control*>(_mem);
+        _buffer = _mem + ControlSize;
+        _capacity = powerOfTwo;
+        _capacityBlocks = _capacity / BlockSize;
+
+        if (created)
+        {
+            // the file is zeroed, the magic goes last so a reopen never sees half a control page
+            new (&_control->_head) std::atomic<size_t>{0};
+            new (&_control->_tail) std::atomic<size_t>{0};
+            _control->_capacity = _capacity;
+            asAtomic(_control->_magic).store(control::MagicValue, std::memory_order_release);
+            return;
+        }
+
+        std::string error;
+        if (asAtomic(_control->_magic).load(std::memory_order_acquire) != control::MagicValue)
+        {
+            error = " is not a bufferQueueJournal";
+        }
+        else if (_control->_capacity != _capacity)
+        {
+            error = " has a capacity of " + std::to_string(_control->_capacity) + ", expected " + std::to_string(_capacity);
+        }
+        else if (!recover())
+        {
+            error = " has _head: " + std::to_string(_control->_head.load()) + ", _tail: " + std::to_string(_control->_tail.load());
+        }
+        if (!error.empty())
+        {
+            munmap(_mem, _fileSize);
+            throw std::runtime_error{"bufferQueueJournal: " + path + error};
+        }
+    }
+    ~bufferQueueJournal() override
+    {
+        munmap(_mem, _fileSize);
+    }
+
+    bool push(const char* ptrIn, size_t len)
+    {
+        return bufferQueueMPSC::push(_control->_head, _control->_tail, ptrIn, len, true);
+    }
+    std::pair<const char*, size_t> front(std::string& buffer)
+    {
+        return bufferQueueMPSC::front(_control->_head, _control->_tail, buffer);
+    }
+    bool pop()
+    {
+        // _head publishes the records, the headers can stay
+        return bufferQueueMPSC::pop(_control->_head, _control->_tail, false);
+    }
+    bool empty() const noexcept
+    {
+        return _control->_head.load(std::memory_order_acquire) == _control->_tail.load(std::memory_order_relaxed);
+    }
+
+    // the number of records found when an existing journal was opened
+    size_t recovered() const noexcept {return _recovered;}
+
+    // writes the dirty pages to the file, returns false on an error
+    bool sync()
+    {
+        return msync(_mem, _fileSize, MS_SYNC) == 0;
+    }
+
+    private:
+    // false if the cursors can't belong to this ring
+    bool recover()
+    {
+        const auto headVal{_control->_head.load(std::memory_order_acquire)};
+        const auto tailVal{_control->_tail.load(std::memory_order_acquire)};
+        if (headVal - tailVal >= _capacityBlocks)
+        {
+            return false;
+        }
+
+        // walks the headers only, the payloads aren't touched
+        auto pos{tailVal};
+        while (pos != headVal)
+        {
+            const auto* headerPtr{reinterpret_cast<const header*>(_buffer + (pos % _capacityBlocks) * BlockSize)};
+            if (!headerPtr->verifyMagic() || headerPtr->_len > _capacity || numOfBlocks(headerPtr->_len + sizeof(header)) > headVal - pos)
+            {
+                break;
+            }
+            pos += numOfBlocks(headerPtr->_len + sizeof(header));
+            _recovered++;
+        }
+
+        if (pos != headVal)
+        {
+            _control->_head.store(pos, std::memory_order_release);
+        }
+        return true;
+    }
+
+    char* _mem{nullptr};
+    size_t _fileSize{0};
+    control* _control{nullptr};
+    size_t _recovered{0};
+};
+
+std::ostream& operator<< (std::ostream& stream, const bufferQueueJournal& obj)
+{
+    stream << "_head: " << obj._control->_head << ", _tail: " << obj._control->_tail
+           << ", _capacity: " << obj._capacity << ", recovered: " << obj._recovered;
+    return stream;
+}
+#endif
+
+#if defined(__linux__)
+enum class shmProducers : uint32_t
+{
+    single,
+    multi
+};
+
+/*
+    a bufferQueue in shared memory, for passing messages between processes.
+
+    the shared memory is a layout page followed by the ring:
+        layout page - magic, version, the producers mode and the capacity, checked by attach(),
+                      and _head/_tail, each on its own cache line
+        ring        - the records, in the bufferQueue format, the same offsets in every process
+    one consumer process, one (shmProducers::single) or many (shmProducers::multi) producer processes,
+    both are lock-free and use the bufferQueueMPSC algorithm on the cursors in the layout page.
+
+    create() makes a named (shm_open) or, with an empty name, an anonymous (memfd) queue,
+    attach() maps an existing one by name or by its descriptor (inherited by fork or passed over a unix socket).
+    the creator unlinks the name when it's destroyed, the processes that attached keep their mapping.
+*/
+class bufferQueueShm : protected bufferQueueMPSC
+{
+    friend std::ostream& operator<< (std::ostream& stream, const bufferQueueShm& obj);
+
+    struct layout
+    {
+        constexpr static uint64_t MagicValue{0x6275665175657565ULL}; // "bufQueue"
+        constexpr static uint32_t Version{1};
+        uint64_t _magic;
+        uint32_t _version;
+        shmProducers _producers;
+        uint64_t _capacity;
+        alignas(64) std::atomic<size_t> _head;
+        alignas(64) std::atomic<size_t> _tail;
+    };
+    constexpr static size_t RingOffset{4096};
+    static_assert(sizeof(layout) <= RingOffset, "the layout fits in its page");
+    static_assert(std::atomic<size_t>::is_always_lock_free, "lock-free atomics are address free, they work across processes");
+
+    struct mapping
+    {
+        char* _mem;
+        size_t _size;
+        int _fd;
+    };
+
+    public:
+    static std::unique_ptr<bufferQueueShm> create(const std::string& name, size_t capacity, shmProducers producers)
+    {
+        size_t powerOfTwo{1};
+        while(powerOfTwo <= capacity)
+        {
+            powerOfTwo <<= 1;
+        }
+
+        const int fd{name.empty() ? memfd_create("bufferQueueShm", MFD_CLOEXEC) : shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600)};
+        if (fd < 0)
+        {
+            throw std::system_error{errno, std::generic_category(), "bufferQueueShm: create " + name};
+        }
+        if (ftruncate(fd, static_cast<off_t>(RingOffset + powerOfTwo)) != 0)
+        {
+            const int err{errno};
+            close(fd);
+            unlink(name);
+            throw std::system_error{err, std::generic_category(), "bufferQueueShm: ftruncate " + name};
+        }
+        mapping m{map(fd, RingOffset + powerOfTwo)};
+        if (m._mem == nullptr)
+        {
+            unlink(name);
+            throw std::system_error{errno, std::generic_category(), "bufferQueueShm: mmap " + name};
+        }
+
+        // the memory is zeroed, the magic goes last so an attacher never sees half a layout
+        auto* l{reinterpret_cast<layout*>(m._mem)};
+        new (&l->_head) std::atomic<size_t>{0};
+        new (&l->_tail) std::atomic<size_t>{0};
+        l->_version = layout::Version;
+        l->_producers = producers;
+        l->_capacity = powerOfTwo;
+        asAtomic(l->_magic).store(layout::MagicValue, std::memory_order_release);
+
+        return std::unique_ptr<bufferQueueShm>{new bufferQueueShm{m, name, true}};
+    }
+    static std::unique_ptr<bufferQueueShm> attach(const std::string& name)
+    {
+        const int fd{shm_open(name.c_str(), O_RDWR, 0)};
+        if (fd < 0)
+        {
+            throw std::system_error{errno, std::generic_category(), "bufferQueueShm: attach " + name};
+        }
+        return attachFd(fd, name);
+    }
+    static std::unique_ptr<bufferQueueShm> attach(int fd)
+    {
+        const int dupFd{fcntl(fd, F_DUPFD_CLOEXEC, 0)};
+        if (dupFd < 0)
+        {
+            throw std::system_error{errno, std::generic_category(), "bufferQueueShm: attach fd " + std::to_string(fd)};
+        }
+        return attachFd(dupFd, "fd " + std::to_string(fd));
+    }
+    ~bufferQueueShm() override
+    {
+        munmap(_mem, _size);
+        close(_fd);
+        if (_owner)
+        {
+            unlink(_name);
+        }
+    }
+
+    bool push(const char* ptrIn, size_t len)
+    {
+        return bufferQueueMPSC::push(_layout->_head, _layout->_tail, ptrIn, len, _layout->_producers == shmProducers::single);
+    }
+    std::pair<const char*, size_t> front(std::string& buffer)
+    {
+        return bufferQueueMPSC::front(_layout->_head, _layout->_tail, buffer);
+    }
+    bool pop()
+    {
+        return bufferQueueMPSC::pop(_layout->_head, _layout->_tail, _layout->_producers == shmProducers::multi);
+    }
+    bool empty() const noexcept
+    {
+        return _layout->_head.load(std::memory_order_acquire) == _layout->_tail.load(std::memory_order_relaxed);
+    }
+
+    // the descriptor of the shared memory, to pass an anonymous queue to another process
+    int fd() const noexcept {return _fd;}
+
+    private:
+    bufferQueueShm(const mapping& m, const std::string& name, bool owner)
+    : bufferQueueMPSC{m._mem + RingOffset, reinterpret_cast<const layout*>(m._mem)->_capacity},
+      _mem{m._mem}, _size{m._size}, _fd{m._fd}, _layout{reinterpret_cast<layout*>(m._mem)}, _name{name}, _owner{owner}
+    {}
+
+    static mapping map(int fd, size_t size)
+    {
+        void* mem{mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)};
+        if (mem == MAP_FAILED)
+        {
+            const int err{errno};
+            close(fd);
+            errno = err;
+            return {nullptr, 0, -1};
+        }
+        return {static_cast<char*>(mem), size, fd};
+    }
+    static std::unique_ptr<bufferQueueShm> attachFd(int fd, const std::string& what)
+    {
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < RingOffset)
+        {
+            close(fd);
+            throw std::runtime_error{"bufferQueueShm: " + what + " is not a bufferQueueShm"};
+        }
+        mapping m{map(fd, static_cast<size_t>(st.st_size))};
+        if (m._mem == nullptr)
+        {
+            throw std::system_error{errno, std::generic_category(), "bufferQueueShm: mmap " + what};
+        }
+
+        const auto* l{reinterpret_cast<layout*>(m._mem)};
+        std::string error;
+        if (asAtomic(const_cast<uint64_t&>(l->_magic)).load(std::memory_order_acquire) != layout::MagicValue)
+        {
+            error = " is not a bufferQueueShm";
+        }
+        else if (l->_version != layout::Version)
+        {
+            error = " has layout version " + std::to_string(l->_version) + ", expected " + std::to_string(layout::Version);
+        }
+        else if (RingOffset + l->_capacity != m._size)
+        {
+            error = " has a capacity of " + std::to_string(l->_capacity) + " in " + std::to_string(m._size) + " bytes";
+        }
+        if (!error.empty())
+        {
+            munmap(m._mem, m._size);
+            close(fd);
+            throw std::runtime_error{"bufferQueueShm: " + what + error};
+        }
+        return std::unique_ptr<bufferQueueShm>{new bufferQueueShm{m, "", false}};
+    }
+    static void unlink(const std::string& name)
+    {
+        if (!name.empty())
+        {
+            shm_unlink(name.c_str());
+        }
+    }
+
+    char* _mem;
+    size_t _size;
+    int _fd;
+    layout* _layout;
+    std::string _name;
+    bool _owner;
+};
+
+std::ostream& operator<< (std::ostream& stream, const bufferQueueShm& obj)
+{
+    stream << "_head: " << obj._layout->_head << ", _tail: " << obj._layout->_tail
+           << ", _capacity: " << obj._capacity << ", producers: " << static_cast<uint32_t>(obj._layout->_producers);
+    return stream;
+}
+#endif
+
+/*
+    one producer, one consumer, the memory grows with the burst instead of being allocated for the worst case.
+
+    a chain of segments, each one a bufferQueue:
+        push  - into the last segment, when it's full the producer takes a segment from the pool,
+                writes the record into it and links it after the full one
+        front/pop - from the first segment, once it's empty and a next one is linked it's drained for good,
+                the consumer gives it back to the pool and moves on
+    the pool keeps up to spareSegments drained segments for the next burst and frees the rest,
+    no more than maxSegments are allocated at a time, then push fails like a full bufferQueue.
+    while one segment is enough (no burst) push/front/pop are bufferQueue's plus a check, the pool and its mutex are off that path.
+    the segments are mirrored by default, they are mapped so a freed one goes back to the OS,
+    a heap segment tends to stay in the allocator and the process keeps the burst's memory.
+*/
+class bufferQueueSegmented
+{
+    friend std::ostream& operator<< (std::ostream& stream, const bufferQueueSegmented& obj);
+
+    struct segment
+    {
+        segment(size_t capacity, bufferMapping mapping): _queue{capacity, mapping} {}
+
+        bufferQueue _queue;
+        std::atomic<segment*> _next{nullptr};
+    };
+
+    public:
+    bufferQueueSegmented(size_t segmentCapacity, size_t maxSegments, size_t spareSegments = 1, bufferMapping mapping = bufferMapping::mirrored)
+    : _segmentCapacity{segmentCapacity}, _maxSegments{maxSegments}, _spareSegments{spareSegments}, _mapping{mapping}
+    {
+        _write = _read = takeSegment();
+    }
+    bufferQueueSegmented(const bufferQueueSegmented&) = delete;
+    bufferQueueSegmented& operator=(const bufferQueueSegmented&) = delete;
+    ~bufferQueueSegmented()
+    {
+        for (auto* s{_read} ; s != nullptr ; )
+        {
+            auto* next{s->_next.load(std::memory_order_relaxed)};
+            delete s;
+            s = next;
+        }
+        for (auto* s : _spare)
+        {
+            delete s;
+        }
+    }
+
+    bool push(const char* ptrIn, size_t len)
+    {
+        if (_write->_queue.push(ptrIn, len))
+        {
+            return true;
+        }
+
+        // the last segment is full
+        auto* next{takeSegment()};
+        if (next == nullptr)
+        {
+            return false;
+        }
+        if (!next->_queue.push(ptrIn, len))
+        {
+            // larger than a segment
+            recycle(next);
+            return false;
+        }
+        _write->_next.store(next, std::memory_order_release);
+        _write = next;
+        return true;
+    }
+    std::pair<const char*, size_t> front(std::string& buffer)
+    {
+        return readable()->_queue.front(buffer);
+    }
+    bool pop()
+    {
+        return readable()->_queue.pop();
+    }
+    bool empty()
+    {
+        return readable()->_queue.empty();
+    }
+
+    // segments that are in the chain or in the pool
+    size_t segments() const
+    {
+        std::lock_guard<std::mutex> l{_poolMtx};
+        return _allocated;
+    }
+
+    private:
+    // the first segment that may have records
+    segment* readable()
+    {
+        while (_read->_queue.empty())
+        {
+            auto* next{_read->_next.load(std::memory_order_acquire)};
+            // records pushed before next was linked are visible now
+            if (next == nullptr || !_read->_queue.empty())
+            {
+                break;
+            }
+            auto* drained{_read};
+            _read = next;
+            recycle(drained);
+        }
+        return _read;
+    }
+    segment* takeSegment()
+    {
+        std::lock_guard<std::mutex> l{_poolMtx};
+        if (!_spare.empty())
+        {
+            auto* s{_spare.back()};
+            _spare.pop_back();
+            return s;
+        }
+        if (_allocated == _maxSegments)
+        {
+            return nullptr;
+        }
+        _allocated++;
+        return new segment{_segmentCapacity, _mapping};
+    }
+    void recycle(segment* s)
+    {
+        // drained, its ring continues from where it is
+        s->_next.store(nullptr, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> l{_poolMtx};
+        if (_spare.size() < _spareSegments)
+        {
+            _spare.push_back(s);
+            return;
+        }
+        _allocated--;
+        delete s;
+    }
+
+    const size_t _segmentCapacity;
+    const size_t _maxSegments;
+    const size_t _spareSegments;
+    const bufferMapping _mapping;
+    segment* _write{nullptr}; // the producer's
+    segment* _read{nullptr};  // the consumer's
+    mutable std::mutex _poolMtx;
+    std::vector<segment*> _spare;
+    size_t _allocated{0};
+};
+
+std::ostream& operator<< (std::ostream& stream, const bufferQueueSegmented& obj)
+{
+    stream << "_segmentCapacity: " << obj._segmentCapacity << ", _maxSegments: " << obj._maxSegments
+           << ", segments: " << obj.segments();
+    return stream;
+}
+
+/*
+    a visitor made of lambdas, queue.visit(overloaded{[](const a&){...}, [](const b&){...}})
+*/
+template<typename... Ts>
+struct overloaded : Ts...
+{
+    using Ts::operator()...;
+};
+template<typename... Ts>
+overloaded(Ts...) -> overloaded<Ts...>;
+
+/*
+    records of a fixed list of trivially copyable types, one producer one consumer, nothing is serialized.
+
+    a record is the compact header, the 32 bit index of its type in Types and the object,
+    the header and the index fill one 8 bytes block so the object is 8 bytes aligned in the ring.
+        push(obj) / emplace<T>(args...) - construct the object in the ring, false when there is no room
+        visit(visitor, maxRecords)      - calls visitor(const T&) for each record through a table indexed by the type,
+                                          the reference points into the ring and is valid only inside the call
+    mirrored by default so a record is never split, in a heap ring a wrapped record is copied to an aligned object first.
+*/
+template<typename... Types>
+class typedBufferQueue : protected bufferQueueCompact
+{
+    template<typename... Ts>
+    friend std::ostream& operator<< (std::ostream& stream, const typedBufferQueue<Ts...>& obj);
+
+    using typeId = uint32_t;
+    static_assert(sizeof(header) + sizeof(typeId) == BlockSize, "the object starts on the second block of a record");
+    static_assert((std::is_trivially_copyable_v<Types> && ...), "the objects are copied as bytes");
+    static_assert(((alignof(Types) <= BlockSize) && ...), "the objects are aligned to a block");
+
+    public:
+    typedBufferQueue(size_t capacity, bufferMapping mapping = bufferMapping::mirrored): bufferQueueCompact{capacity, mapping} {}
+    using bufferQueueCompact::mirrored;
+    using bufferQueueCompact::empty;
+
+    template<typename T>
+    bool push(const T& obj)
+    {
+        return emplace<T>(obj);
+    }
+    template<typename T, typename... Args>
+    bool emplace(Args&&... args)
+    {
+        constexpr typeId id{indexOf<T>()};
+        static_assert(id < sizeof...(Types), "T isn't one of the queue's types");
+
+        const auto s{reserve(sizeof(typeId) + sizeof(T))};
+        if (!s.valid())
+        {
+            return false;
+        }
+        if (s._second.second == 0)
+        {
+            std::memcpy(s._first.first, &id, sizeof(id));
+            new (s._first.first + sizeof(id)) T{std::forward<Args>(args)...};
+        }
+        else
+        {
+            // wraps around the end of a heap ring
+            const T obj{std::forward<Args>(args)...};
+            char record[sizeof(typeId) + sizeof(T)];
+            std::memcpy(record, &id, sizeof(id));
+            std::memcpy(record + sizeof(id), &obj, sizeof(T));
+            copyIn(s, record, sizeof(record));
+        }
+        commit();
+        return true;
+    }
+
+    template<typename Visitor>
+    size_t visit(Visitor&& visitor, size_t maxRecords = SIZE_MAX)
+    {
+        using handler = void (*)(Visitor&, const char*);
+        static constexpr handler handlers[]{&visitOne<Visitor, Types>...};
+
+        return consume([&visitor](const char* ptr, size_t /*len*/){
+            typeId id{0};
+            std::memcpy(&id, ptr, sizeof(id));
+            assert(id < sizeof...(Types) && "corrupted data, unknown type");
+            handlers[id](visitor, ptr + sizeof(id));
+        }, maxRecords);
+    }
+
+    private:
+    template<typename T>
+    static constexpr typeId indexOf()
+    {
+        constexpr bool matches[]{std::is_same_v<T, Types>...};
+        for (typeId i = 0 ; i < sizeof...(Types) ; i++)
+        {
+            if (matches[i])
+            {
+                return i;
+            }
+        }
+        return sizeof...(Types);
+    }
+    template<typename Visitor, typename T>
+    static void visitOne(Visitor& visitor, const char* ptr)
+    {
+        if (reinterpret_cast<uintptr_t>(ptr) % alignof(T) != 0)
+        {
+            // a wrapped record, consume() put it together in a string
+            alignas(T) char obj[sizeof(T)];
+            std::memcpy(obj, ptr, sizeof(T));
+            visitor(*std::launder(reinterpret_cast<const T*>(obj)));
+            return;
+        }
+        visitor(*std::launder(reinterpret_cast<const T*>(ptr)));
+    }
+};
+
+template<typename... Types>
+std::ostream& operator<< (std::ostream& stream, const typedBufferQueue<Types...>& obj)
+{
+    stream << static_cast<const bufferQueueCompact&>(obj) << ", types: " << sizeof...(Types);
+    return stream;
+}
+
+/*
+    buffers for messages that don't go through a ring, in power of 2 size classes.
+    a released buffer is kept for the next allocation of its class while the pool holds less than maxCachedBytes,
+    the producer allocates and the consumer releases, a mutex orders them, it's taken once per large message.
+*/
+class largeBufferPool
+{
+    friend std::ostream& operator<< (std::ostream& stream, const largeBufferPool& obj);
+
+    public:
+    /*
+        the only owner of a pool buffer, gives it back to the pool when destroyed
+    */
+    class buffer
+    {
+        friend class largeBufferPool;
+
+        public:
+        buffer() = default;
+        buffer(buffer&& other) noexcept
+        : _data{std::exchange(other._data, nullptr)}, _size{other._size}, _capacity{other._capacity}, _pool{other._pool}
+        {}
+        buffer& operator=(buffer&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                _data = std::exchange(other._data, nullptr);
+                _size = other._size;
+                _capacity = other._capacity;
+                _pool = other._pool;
+            }
+            return *this;
+        }
+        buffer(const buffer&) = delete;
+        buffer& operator=(const buffer&) = delete;
+        ~buffer() {reset();}
+
+        bool valid() const noexcept {return _data != nullptr;}
+        char* data() noexcept {return _data;}
+        const char* data() const noexcept {return _data;}
+        size_t size() const noexcept {return _size;}
+        size_t capacity() const noexcept {return _capacity;}
+        largeBufferPool* pool() const noexcept {return _pool;}
+
+        // hands the memory over, the caller gives it back with largeBufferPool::release
+        char* release() noexcept {return std::exchange(_data, nullptr);}
+        void reset() noexcept
+        {
+            if (_data != nullptr)
+            {
+                _pool->release(std::exchange(_data, nullptr), _capacity);
+            }
+        }
+
+        private:
+        buffer(char* data, size_t size, size_t capacity, largeBufferPool* pool)
+        : _data{data}, _size{size}, _capacity{capacity}, _pool{pool}
+        {}
+
+        char* _data{nullptr};
+        size_t _size{0};
+        size_t _capacity{0};
+        largeBufferPool* _pool{nullptr};
+    };
+
+    largeBufferPool(size_t maxCachedBytes): _maxCachedBytes{maxCachedBytes} {}
+    largeBufferPool(const largeBufferPool&) = delete;
+    largeBufferPool& operator=(const largeBufferPool&) = delete;
+    ~largeBufferPool()
+    {
+        for (auto& sizeClass : _free)
+        {
+            for (auto* data : sizeClass)
+            {
+                delete [] data;
+            }
+        }
+    }
+
+    buffer allocate(size_t len)
+    {
+        size_t sizeClass{0};
+        while ((size_t{1} << sizeClass) < len)
+        {
+            sizeClass++;
+        }
+        const size_t capacity{size_t{1} << sizeClass};
+        {
+            std::lock_guard<std::mutex> l{_mtx};
+            if (sizeClass < _free.size() && !_free[sizeClass].empty())
+            {
+                auto* data{_free[sizeClass].back()};
+                _free[sizeClass].pop_back();
+                _cachedBytes -= capacity;
+                return {data, len, capacity, this};
+            }
+            _allocations++;
+        }
+        return {new char [capacity], len, capacity, this};
+    }
+    // a buffer that was taken out of its handle with buffer::release, in a handle again
+    buffer adopt(char* data, size_t size, size_t capacity)
+    {
+        return {data, size, capacity, this};
+    }
+    // a buffer that was taken out of its handle with buffer::release, back to the pool
+    void release(char* data, size_t capacity)
+    {
+        {
+            std::lock_guard<std::mutex> l{_mtx};
+            if (_cachedBytes + capacity <= _maxCachedBytes)
+            {
+                size_t sizeClass{0};
+                while ((size_t{1} << sizeClass) < capacity)
+                {
+                    sizeClass++;
+                }
+                if (_free.size() <= sizeClass)
+                {
+                    _free.resize(sizeClass + 1);
+                }
+                _free[sizeClass].push_back(data);
+                _cachedBytes += capacity;
+                return;
+            }
+        }
+        delete [] data;
+    }
+
+    // buffers that were allocated from the heap, not reused
+    size_t allocations() const
+    {
+        std::lock_guard<std::mutex> l{_mtx};
+        return _allocations;
+    }
+
+    private:
+    const size_t _maxCachedBytes;
+    mutable std::mutex _mtx;
+    std::vector<std::vector<char*>> _free; // by size class, log2 of the capacity
+    size_t _cachedBytes{0};
+    size_t _allocations{0};
+};
+
+std::ostream& operator<< (std::ostream& stream, const largeBufferPool& obj)
+{
+    std::lock_guard<std::mutex> l{obj._mtx};
+    stream << "_maxCachedBytes: " << obj._maxCachedBytes << ", _cachedBytes: " << obj._cachedBytes << ", _allocations: " << obj._allocations;
+    return stream;
+}
+
+/*
+    one producer, one consumer, the ring is sized for the common messages and large ones go around it.
+
+    a record starts with a tag byte:
+        inline     - the payload follows, messages shorter than threshold
+        descriptor - pointer, length, capacity and pool of a largeBufferPool buffer, the queue owns the buffer until it's popped
+    push(ptr, len)          - inline, or copied once into a pool buffer, also below threshold when the message can't fit in the ring
+    allocate(len) + push(buffer) - the producer writes a large message straight into a pool buffer, push moves it into the queue
+    front/pop               - an out of line message is read in place in its buffer, pop gives the buffer back to the pool
+    take()                  - the consumer keeps the buffer of the front message, it goes back to the pool when the handle is destroyed
+*/
+class bufferQueueLarge
+{
+    friend std::ostream& operator<< (std::ostream& stream, const bufferQueueLarge& obj);
+
+    enum class recordTag : char
+    {
+        inlined,
+        descriptor
+    };
+    struct descriptor
+    {
+        char* _data;
+        size_t _size;
+        size_t _capacity;
+        largeBufferPool* _pool; // the buffer's own, push(buffer) takes buffers of any pool
+    };
+
+    public:
+    bufferQueueLarge(size_t capacity, size_t threshold, size_t maxCachedBytes = 64 * 1024 * 1024, bufferMapping mapping = bufferMapping::heap)
+    : _ring{capacity, mapping}, _threshold{threshold}, _pool{maxCachedBytes}
+    {}
+    bufferQueueLarge(const bufferQueueLarge&) = delete;
+    bufferQueueLarge& operator=(const bufferQueueLarge&) = delete;
+    ~bufferQueueLarge()
+    {
+        // the buffers of the messages that were not popped
+        while (pop());
+    }
+
+    largeBufferPool::buffer allocate(size_t len)
+    {
+        return _pool.allocate(len);
+    }
+
+    bool push(const char* ptrIn, size_t len)
+    {
+        if (len < _threshold && sizeof(recordTag) + len <= _ring.maxPayload())
+        {
+            const auto tag{recordTag::inlined};
+            const std::pair<const char*, size_t> fragments[]{{reinterpret_cast<const char*>(&tag), sizeof(tag)}, {ptrIn, len}};
+            return _ring.push(fragments, 2);
+        }
+        // the descriptor's record first, a full ring costs no allocation and no copy of the payload
+        const auto s{_ring.reserve(sizeof(recordTag) + sizeof(descriptor))};
+        if (!s.valid())
+        {
+            return false;
+        }
+        auto buffer{_pool.allocate(len)};
+        std::memcpy(buffer.data(), ptrIn, len);
+        commit(s, std::move(buffer));
+        return true;
+    }
+    // on success the queue owns the buffer, on failure it's left with the caller, pop() gives it back to the pool it came from
+    bool push(largeBufferPool::buffer&& buffer)
+    {
+        const auto s{_ring.reserve(sizeof(recordTag) + sizeof(descriptor))};
+        if (!s.valid())
+        {
+            return false;
+        }
+        commit(s, std::move(buffer));
+        return true;
+    }
+
+    std::pair<const char*, size_t> front(std::string& buffer)
+    {
+        auto [ptr, len] = _ring.front(buffer);
+        if (ptr == nullptr)
+        {
+            return {nullptr, 0};
+        }
+        if (static_cast<recordTag>(ptr[0]) == recordTag::inlined)
+        {
+            return {ptr + 1, len - 1};
+        }
+        const auto d{readDescriptor(ptr)};
+        return {d._data, d._size};
+    }
+    bool pop()
+    {
+        auto [ptr, len] = _ring.front(_scratch);
+        if (ptr == nullptr)
+        {
+            return false;
+        }
+        if (static_cast<recordTag>(ptr[0]) == recordTag::descriptor)
+        {
+            const auto d{readDescriptor(ptr)};
+            d._pool->release(d._data, d._capacity);
+        }
+        return _ring.pop();
+    }
+    // the front message's buffer, not valid when the queue is empty or the message is inline
+    largeBufferPool::buffer take()
+    {
+        auto [ptr, len] = _ring.front(_scratch);
+        if (ptr == nullptr || static_cast<recordTag>(ptr[0]) != recordTag::descriptor)
+        {
+            return {};
+        }
+        const auto d{readDescriptor(ptr)};
+        _ring.pop();
+        return d._pool->adopt(d._data, d._size, d._capacity);
+    }
+    bool empty() const noexcept
+    {
+        return _ring.empty();
+    }
+    const largeBufferPool& pool() const noexcept {return _pool;}
+
+    private:
+    // writes the descriptor of buffer into the reserved record and publishes it, the queue owns the buffer from here
+    void commit(const bufferQueue::spans& s, largeBufferPool::buffer&& buffer)
+    {
+        char record[sizeof(recordTag) + sizeof(descriptor)];
+        record[0] = static_cast<char>(recordTag::descriptor);
+        const descriptor d{buffer.data(), buffer.size(), buffer.capacity(), buffer.pool()};
+        std::memcpy(record + 1, &d, sizeof(d));
+        std::memcpy(s._first.first, record, s._first.second);
+        std::memcpy(s._second.first, record + s._first.second, s._second.second);
+        _ring.commit();
+        buffer.release();
+    }
+    static descriptor readDescriptor(const char* ptr)
+    {
+        descriptor d;
+        std::memcpy(&d, ptr + 1, sizeof(d));
+        return d;
+    }
+
+    bufferQueue _ring;
+    const size_t _threshold;
+    largeBufferPool _pool;
+    std::string _scratch; // the consumer's, for pop() and take() of a wrapped record
+};
+
+std::ostream& operator<< (std::ostream& stream, const bufferQueueLarge& obj)
+{
+    stream << obj._ring << ", _threshold: " << obj._threshold << ", pool: " << obj._pool;
+    return stream;
+}
+
+/*
+    what the producer of a bufferQueueMulticast does when the slowest reader holds the space it needs
+        block  - push fails like a full bufferQueue
+        cutOff - the readers in the way are cut off, their records are reused
+*/
+enum class lagPolicy
+{
+    block,
+    cutOff
+};
+
+/*
+    one producer, many readers that each see every record, a record is written once.
+
+    like bufferQueueSPMC the cursors count blocks from the start and never wrap.
+        _head       - the producer publishes records by advancing it
+        _readers    - a cursor per registered reader, in its own cache line, it reads in place and advances it
+        _reclaimed  - the producer's own, the slowest reader's cursor when it last looked,
+                      push looks at the readers again only when the space up to _reclaimed is used up
+    a reader added with addReader() sees the records pushed from then on, removeReader() frees its slot.
+    with lagPolicy::cutOff a reader that is cut off gets nothing more, pop/consume return false/0 and cutOff(id) is true,
+    it rejoins with removeReader() and addReader().
+    mirrored by default so records are read in place, in a heap ring a record that wraps is copied into buffer.
+
+    reading in place is for lagPolicy::block only. with cutOff the producer may write over a record a reader is on,
+    so every reader copies every record into its buffer and checks its cursor after the copy: N readers, N copies,
+    no faster than a bufferQueue per reader. the producer writes and the readers copy the payloads in 8 byte atomics.
+*/
+class bufferQueueMulticast : protected bufferQueue
+{
+    friend std::ostream& operator<< (std::ostream& stream, const bufferQueueMulticast& obj);
+
+    constexpr static size_t CutOffBit{size_t{1} << 63};
+    constexpr static size_t Inactive{SIZE_MAX}; // has CutOffBit too, an unused slot reads nothing
+
+    struct alignas(64) readerCursor
+    {
+        std::atomic<size_t> _pos{Inactive};
+    };
+
+    public:
+    bufferQueueMulticast(size_t capacity, size_t maxReaders, lagPolicy policy = lagPolicy::block, bufferMapping mapping = bufferMapping::mirrored)
+    : bufferQueue{capacity, mapping}, _readers{new readerCursor[maxReaders]}, _maxReaders{maxReaders}, _policy{policy}
+    {}
+    using bufferQueue::mirrored;
+
+    // the reader's id, SIZE_MAX when all maxReaders slots are in use
+    size_t addReader()
+    {
+        // readers against readers, the producer never takes it
+        std::lock_guard<std::mutex> l{_mtx};
+        for (size_t id = 0 ; id < _maxReaders ; id++)
+        {
+            if (_readers[id]._pos.load(std::memory_order_relaxed) == Inactive)
+            {
+                join(id);
+                return id;
+            }
+        }
+        return SIZE_MAX;
+    }
+    void removeReader(size_t id)
+    {
+        std::lock_guard<std::mutex> l{_mtx};
+        _readers[id]._pos.store(Inactive, std::memory_order_release);
+    }
+
+    bool push(const char* ptrIn, size_t len)
+    {
+        const auto headVal{_head.load(std::memory_order_relaxed)};
+        const auto blocksNeeded{numOfBlocks(len + sizeof(header))};
+        // keeps one block free like bufferQueue
+        if (_capacityBlocks - 1 - (headVal - _reclaimed) < blocksNeeded)
+        {
+            if (_capacityBlocks - 1 < blocksNeeded)
+            {
+                return false;
+            }
+            reclaim(headVal, blocksNeeded);
+            if (_capacityBlocks - 1 - (headVal - _reclaimed) < blocksNeeded)
+            {
+                return false;
+            }
+        }
+
+        const auto index{headVal % _capacityBlocks};
+        auto* headerPtr{headerAt(headVal)};
+        auto* ptr{_buffer + index * BlockSize + sizeof(header)};
+
+        const auto bufferAheadLen{_mirrored ? len : std::min(len, (_capacityBlocks - index) * BlockSize - sizeof(header))};
+        if (_policy == lagPolicy::block)
+        {
+            std::memcpy(ptr, ptrIn, bufferAheadLen);
+            std::memcpy(_buffer, ptrIn + bufferAheadLen, len - bufferAheadLen);
+        }
+        else
+        {
+            storeWords(ptr, ptrIn, bufferAheadLen);
+            storeWords(_buffer, ptrIn + bufferAheadLen, len - bufferAheadLen);
+        }
+
+        // a reader that is being cut off may still read the header
+        asAtomic(headerPtr->_len).store(len, std::memory_order_relaxed);
+        asAtomic(headerPtr->_magic).store(header::MagicValue, std::memory_order_relaxed);
+        _head.store(headVal + blocksNeeded, std::memory_order_release);
+        return true;
+    }
+
+    /*
+        the oldest record reader id hasn't popped, nullptr when there is none or the reader was cut off.
+        in place, with lagPolicy::cutOff it's a copy in buffer that was checked against the reader's cursor.
+    */
+    std::pair<const char*, size_t> front(size_t id, std::string& buffer)
+    {
+        const auto pos{_readers[id]._pos.load(std::memory_order_relaxed)};
+        const auto headVal{_head.load(std::memory_order_acquire)};
+        if ((pos & CutOffBit) != 0 || pos == headVal)
+        {
+            return {nullptr, 0};
+        }
+        const auto len{recordLen(pos, headVal)};
+        if (len == SIZE_MAX)
+        {
+            return {nullptr, 0};
+        }
+        const auto* ptr{readChecked(id, pos, pos, len, buffer)};
+        if (ptr == nullptr)
+        {
+            return {nullptr, 0};
+        }
+        return {ptr, len};
+    }
+    // false when there is no record or the reader was cut off
+    bool pop(size_t id)
+    {
+        const auto pos{_readers[id]._pos.load(std::memory_order_relaxed)};
+        const auto headVal{_head.load(std::memory_order_acquire)};
+        if ((pos & CutOffBit) != 0 || pos == headVal)
+        {
+            return false;
+        }
+        const auto len{recordLen(pos, headVal)};
+        return len != SIZE_MAX && advance(id, pos, pos + numOfBlocks(len + sizeof(header)));
+    }
+
+    /*
+        calls callback(const char* ptr, size_t len) in place for up to maxRecords records of reader id,
+        moves its cursor once at the end, returns how many were consumed (0 when the reader was cut off before the call).
+        buffer is used only for a record that wraps around the end of a heap buffer, ptr is valid only inside the callback.
+        with lagPolicy::cutOff every record is copied into buffer and checked against the cursor before the callback,
+        a cut off reader stops at the last whole record and gets the count of the records the callback saw.
+    */
+    template<typename Callback>
+    size_t consume(size_t id, Callback&& callback, std::string& buffer, size_t maxRecords = SIZE_MAX)
+    {
+        const auto start{_readers[id]._pos.load(std::memory_order_relaxed)};
+        const auto headVal{_head.load(std::memory_order_acquire)};
+        if ((start & CutOffBit) != 0)
+        {
+            return 0;
+        }
+
+        size_t consumed{0};
+        auto pos{start};
+        for (; consumed < maxRecords && pos != headVal ; consumed++)
+        {
+            const auto len{recordLen(pos, headVal)};
+            if (len == SIZE_MAX)
+            {
+                return consumed;
+            }
+            const auto* ptr{readChecked(id, start, pos, len, buffer)};
+            if (ptr == nullptr)
+            {
+                return consumed;
+            }
+            callback(ptr, len);
+            pos += numOfBlocks(len + sizeof(header));
+            if (pos != headVal)
+            {
+                prefetch(_buffer + (pos % _capacityBlocks) * BlockSize);
+            }
+        }
+
+        // a cut off reader doesn't move, the records were whole when the callback got them
+        if (consumed > 0)
+        {
+            advance(id, start, pos);
+        }
+        return consumed;
+    }
+
+    // nothing to read, also when the reader was cut off
+    bool empty(size_t id) const noexcept
+    {
+        const auto pos{_readers[id]._pos.load(std::memory_order_relaxed)};
+        return (pos & CutOffBit) != 0 || pos == _head.load(std::memory_order_acquire);
+    }
+    bool cutOff(size_t id) const noexcept
+    {
+        const auto pos{_readers[id]._pos.load(std::memory_order_relaxed)};
+        return pos != Inactive && (pos & CutOffBit) != 0;
+    }
+    // readers cut off so far
+    size_t cutOffs() const noexcept
+    {
+        return _cutOffs.load(std::memory_order_relaxed);
+    }
+
+    private:
+    header* headerAt(size_t pos) const
+    {
+        return reinterpret_cast<header*>(_buffer + (pos % _capacityBlocks) * BlockSize);
+    }
+    // SIZE_MAX when the header can't be a published record, the reader is being cut off and it was overwritten
+    size_t recordLen(size_t pos, size_t headVal) const
+    {
+        auto* headerPtr{headerAt(pos)};
+        const auto len{asAtomic(headerPtr->_len).load(std::memory_order_relaxed)};
+        if (asAtomic(headerPtr->_magic).load(std::memory_order_relaxed) != header::MagicValue ||
+            len > (std::min(headVal - pos, _capacityBlocks - 1) * BlockSize))
+        {
+            return SIZE_MAX;
+        }
+        return len;
+    }
+    const char* read(size_t pos, size_t len, std::string& buffer) const
+    {
+        const auto index{pos % _capacityBlocks};
+        const auto* ptr{_buffer + index * BlockSize + sizeof(header)};
+        const auto bufferAheadLen{(_capacityBlocks - index) * BlockSize - sizeof(header)};
+        if (len <= bufferAheadLen || _mirrored)
+        {
+            return ptr;
+        }
+        buffer.resize(len);
+        std::memcpy(buffer.data(), ptr, bufferAheadLen);
+        std::memcpy(buffer.data() + bufferAheadLen, _buffer, len - bufferAheadLen);
+        return buffer.data();
+    }
+    /*
+        read() that is safe from the producer: nullptr when the cursor of reader id isn't start anymore.
+        with lagPolicy::cutOff the producer writes over a reader's records once it cut it off, so the record is
+        copied into buffer first and the cursor is loaded after the copy, an unchanged cursor means a whole copy.
+    */
+    const char* readChecked(size_t id, size_t start, size_t pos, size_t len, std::string& buffer) const
+    {
+        if (_policy == lagPolicy::block)
+        {
+            return read(pos, len, buffer);
+        }
+        const auto index{pos % _capacityBlocks};
+        const auto* ptr{_buffer + index * BlockSize + sizeof(header)};
+        const auto bufferAheadLen{_mirrored ? len : std::min(len, (_capacityBlocks - index) * BlockSize - sizeof(header))};
+        buffer.resize(len);
+        loadWords(buffer.data(), ptr, bufferAheadLen);
+        loadWords(buffer.data() + bufferAheadLen, _buffer, len - bufferAheadLen);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_readers[id]._pos.load(std::memory_order_relaxed) != start)
+        {
+            return nullptr;
+        }
+        return buffer.data();
+    }
+    /*
+        the payload of a record with lagPolicy::cutOff, a reader may copy it while it is written.
+        the words are 8 byte aligned, a payload starts after the header and the ring wraps on a block.
+        the last word is padded, it stays inside the record's last block.
+    */
+    static void storeWords(char* dst, const char* src, size_t len)
+    {
+        for (size_t i = 0 ; i < len ; i += sizeof(uint64_t))
+        {
+            uint64_t word{0};
+            std::memcpy(&word, src + i, std::min(sizeof(word), len - i));
+            asAtomic(*reinterpret_cast<uint64_t*>(dst + i)).store(word, std::memory_order_relaxed);
+        }
+    }
+    static void loadWords(char* dst, const char* src, size_t len)
+    {
+        for (size_t i = 0 ; i < len ; i += sizeof(uint64_t))
+        {
+            const auto word{asAtomic(*reinterpret_cast<uint64_t*>(const_cast<char*>(src + i))).load(std::memory_order_relaxed)};
+            std::memcpy(dst + i, &word, std::min(sizeof(word), len - i));
+        }
+    }
+    /*
+        starts reader id at _head, without a lock against the producer's reclaim().
+        the seq_cst store of the cursor and the seq_cst load of _head after it pair with the fence of reclaim():
+        either reclaim() sees the cursor, or the _head loaded here is at least the one reclaim() worked with.
+        a cursor behind that _head may sit on space the producer reuses, it's moved to the _head it loaded.
+    */
+    void join(size_t id)
+    {
+        auto pos{_head.load(std::memory_order_acquire)};
+        while (true)
+        {
+            _readers[id]._pos.store(pos, std::memory_order_seq_cst);
+            const auto headVal{_head.load(std::memory_order_seq_cst)};
+            if (headVal == pos)
+            {
+                return;
+            }
+            pos = headVal;
+        }
+    }
+    // releases the records before next to the producer, false when the reader was cut off meanwhile
+    bool advance(size_t id, size_t pos, size_t next)
+    {
+        if (_policy == lagPolicy::block)
+        {
+            _readers[id]._pos.store(next, std::memory_order_release);
+            return true;
+        }
+        return _readers[id]._pos.compare_exchange_strong(pos, next, std::memory_order_release, std::memory_order_relaxed);
+    }
+    // moves _reclaimed to the slowest reader, cuts off the ones that hold the space of the next record if the policy says so
+    void reclaim(size_t headVal, size_t blocksNeeded)
+    {
+        // no lock, pairs with join()
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto slowest{headVal};
+        bool cut{false};
+        for (size_t id = 0 ; id < _maxReaders ; id++)
+        {
+            auto pos{_readers[id]._pos.load(std::memory_order_acquire)};
+            while ((pos & CutOffBit) == 0)
+            {
+                if (_policy == lagPolicy::block || _capacityBlocks - 1 - (headVal - pos) >= blocksNeeded)
+                {
+                    slowest = std::min(slowest, pos);
+                    break;
+                }
+                // on failure pos is where the reader moved to, it may be out of the way now
+                if (_readers[id]._pos.compare_exchange_weak(pos, pos | CutOffBit, std::memory_order_acquire, std::memory_order_acquire))
+                {
+                    _cutOffs.fetch_add(1, std::memory_order_relaxed);
+                    cut = true;
+                    break;
+                }
+            }
+        }
+        if (cut)
+        {
+            // pairs with the fence of readChecked(), a reader that copied the new records sees the cut off bit
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+        _reclaimed = slowest;
+    }
+
+    std::unique_ptr<readerCursor[]> _readers;
+    const size_t _maxReaders;
+    const lagPolicy _policy;
+    size_t _reclaimed{0};
+    std::mutex _mtx; // addReader/removeReader against each other
+    std::atomic<size_t> _cutOffs{0};
+};
+
+std::ostream& operator<< (std::ostream& stream, const bufferQueueMulticast& obj)
+{
+    stream << static_cast<const bufferQueue&>(obj) << ", _maxReaders: " << obj._maxReaders << ", readers at: ";
+    for (size_t id = 0 ; id < obj._maxReaders ; id++)
+    {
+        const auto pos{obj._readers[id]._pos.load(std::memory_order_relaxed)};
+        if (pos == bufferQueueMulticast::Inactive)
+        {
+            continue;
+        }
+        stream << id << ':' << (obj.cutOff(id) ? std::string{"cut off"} : std::to_string(pos)) << ' ';
+    }
+    return stream;
+}
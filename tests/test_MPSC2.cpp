@@ -0,0 +1,179 @@
+#include "lockfreeQueue2.h"
+#include "lockfreeQueue.h"
+#include <string>
+#include <thread>
+#include <iostream>
+#include <vector>
+#include <chrono>
+
+constexpr size_t queueSize{1024};
+constexpr size_t maxProducers{16};
+constexpr size_t producerShift{48}; // producer id in the high bits, its own counter in the low bits
+
+// the m2o queues push/pop without blocking, QueueMPSC has try_push/try_pop for that
+template<typename Queue>
+bool queuePush(Queue& q_, size_t v_)
+{
+    return q_.push(v_);
+}
+template<typename T, size_t N, typename Wait>
+bool queuePush(concurency_2026::QueueMPSC<T, N, Wait>& q_, size_t v_)
+{
+    return q_.try_push(v_);
+}
+template<typename Queue>
+bool queuePop(Queue& q_, size_t& v_)
+{
+    return q_.pop(v_);
+}
+template<typename T, size_t N, typename Wait>
+bool queuePop(concurency_2026::QueueMPSC<T, N, Wait>& q_, size_t& v_)
+{
+    return q_.try_pop(v_);
+}
+
+/*
+    producers push for a fixed time, the consumer verifies every producer's elements come in order
+*/
+template<typename Queue>
+bool testProducers(size_t numProducers_, std::chrono::milliseconds duration_)
+{
+    std::cout << "Test : " << numProducers_ << " producers, one consumer, queue: " << typeid(Queue).name() << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+
+    Queue q;
+    std::atomic<bool> res{true};
+    std::atomic<bool> start{false};
+    std::atomic<bool> endPush{false};
+    std::atomic<size_t> producersDone{0};
+    std::atomic<size_t> totalPushed{0};
+    size_t totalPulled{0};
+
+    auto pusher = [&](size_t id_){
+        while(!start.load(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+        size_t cnt{0};
+        while (!endPush.load(std::memory_order_relaxed))
+        {
+            if (queuePush(q, (id_ << producerShift) | cnt))
+            {
+                ++cnt;
+            }
+        }
+        totalPushed += cnt;
+        producersDone += 1;
+    };
+    auto puller = [&](){
+        std::vector<size_t> expected(maxProducers, 0);
+        while(!start.load(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+        while (true)
+        {
+            const bool done{producersDone.load() == numProducers_};
+            size_t v{0};
+            if (!queuePop(q, v))
+            {
+                if (done)
+                {
+                    return;
+                }
+                continue;
+            }
+
+            const size_t id{v >> producerShift};
+            const size_t cnt{v & ((size_t{1} << producerShift) - 1)};
+            if (id >= numProducers_ || expected[id] != cnt)
+            {
+                std::cerr << "Poller error: producer: " << id << ", expected: " << expected[id] << ", received: " << cnt << std::endl;
+                res = false;
+                return;
+            }
+            ++expected[id];
+            ++totalPulled;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.emplace_back(puller);
+    for (size_t i = 0 ; i < numProducers_ ; ++i)
+    {
+        threads.emplace_back(pusher, i);
+    }
+
+    const auto startTp{std::chrono::steady_clock::now()};
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(duration_);
+    endPush.store(true);
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    const auto timeMs{std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTp).count()};
+
+    if (totalPulled != totalPushed)
+    {
+        std::cerr << "pushed: " << totalPushed << " != pulled: " << totalPulled << std::endl;
+        res = false;
+    }
+    std::cout << "producers: " << numProducers_ << ", events: " << totalPulled
+              << ", events per sec: " << totalPulled * 1000 / static_cast<size_t>(timeMs + 1)
+              << ", res: " << res << std::endl << std::endl;
+    return res;
+}
+
+bool testMPSC2Blocking()
+{
+    // yields, a full or empty queue of 2 waits a lot
+    concurency_2026::QueueMPSC<size_t, 2, concurency::yieldWait> q;
+    const size_t numEvents{10000};
+    const size_t numProducers{4};
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0 ; p < numProducers ; ++p)
+    {
+        threads.emplace_back([&q, numEvents](){
+            for (size_t i = 1 ; i <= numEvents ; ++i)
+            {
+                q.push(i);
+            }
+        });
+    }
+
+    size_t sum{0};
+    for (size_t i = 0 ; i < numEvents * numProducers ; ++i)
+    {
+        size_t v{0};
+        q.pop(v);
+        sum += v;
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    const size_t expectedSum{numProducers * numEvents * (numEvents + 1) / 2};
+    std::cout << "blocking push/pop, sum: " << sum << ", expected: " << expectedSum << std::endl;
+    return sum == expectedSum && q.empty();
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+    if (!testMPSC2Blocking())
+        return __LINE__;
+
+    const std::chrono::milliseconds duration{1000};
+    for (size_t numProducers : {2, 4, 8, 16})
+    {
+        if (!testProducers<concurency_2026::QueueMPSC<size_t, queueSize>>(numProducers, duration))
+            return __LINE__;
+        if (!testProducers<concurency::m2oQueue<size_t, queueSize, maxProducers>>(numProducers, duration))
+            return __LINE__;
+        if (!testProducers<concurency::m2oQueue<size_t, queueSize, maxProducers, concurency::commitMode::perSlot>>(numProducers, duration))
+            return __LINE__;
+    }
+    return 0;
+}
@@ -4,6 +4,15 @@
 #include <iostream>
 #include <vector>
 #include <chrono>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 struct Node
 {
@@ -66,6 +75,534 @@ bool testSPSC2_pushWrongElement()
     return true;
 }
 
+/*
+    QueueSPSC before the cached indices, every push reads _tail and every pop reads _head
+*/
+template<typename T, size_t N, typename Wait>
+class QueueSPSCUncached
+{
+    public:
+    void push(const T& elem_)
+    {
+        const auto head{_head.load(std::memory_order_relaxed)};
+        _notFull.wait([this, head](){ return head - _tail.load(std::memory_order_acquire) != N; });
+        _arr[head & (N - 1)] = elem_;
+        _head.store(head + 1, std::memory_order_release);
+        _notEmpty.notify();
+    }
+    void pop(T& elem_)
+    {
+        const auto tail{_tail.load(std::memory_order_relaxed)};
+        _notEmpty.wait([this, tail](){ return tail != _head.load(std::memory_order_acquire); });
+        elem_ = _arr[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        _notFull.notify();
+    }
+
+    private:
+    alignas(64) std::atomic<size_t> _head{0};
+    alignas(64) std::atomic<size_t> _tail{0};
+    alignas(64) std::array<T, N> _arr;
+    Wait _notEmpty;
+    Wait _notFull;
+};
+
+/*
+    hardware cache counters of this process, threads created after start() included.
+    not every machine (or container) allows perf_event_open, then the counts are reported as n/a
+*/
+class cacheCounters
+{
+    public:
+    cacheCounters()
+    {
+#if defined(__linux__)
+        _fds[0] = open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        _fds[1] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#endif
+    }
+    ~cacheCounters()
+    {
+#if defined(__linux__)
+        for (int fd : _fds)
+        {
+            if (fd >= 0)
+                close(fd);
+        }
+#endif
+    }
+    void start()
+    {
+#if defined(__linux__)
+        for (int fd : _fds)
+        {
+            if (fd >= 0)
+            {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+    void stop()
+    {
+#if defined(__linux__)
+        for (size_t i = 0 ; i < 2 ; ++i)
+        {
+            if (_fds[i] >= 0)
+            {
+                ioctl(_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+                uint64_t v{0};
+                _valid[i] = read(_fds[i], &v, sizeof(v)) == sizeof(v);
+                _counts[i] = v;
+            }
+        }
+#endif
+    }
+    void print(std::ostream& os_) const
+    {
+        const char* names[]{"L1D read misses: ", "LLC misses: "};
+        for (size_t i = 0 ; i < 2 ; ++i)
+        {
+            os_ << ", " << names[i];
+            if (_valid[i])
+                os_ << _counts[i];
+            else
+                os_ << "n/a";
+        }
+    }
+
+    private:
+#if defined(__linux__)
+    static int open(uint32_t type_, uint64_t config_)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type_;
+        attr.config = config_;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+    int _fds[2]{-1, -1};
+    bool _valid[2]{false, false};
+    uint64_t _counts[2]{0, 0};
+};
+
+/*
+    one producer, one consumer, ops/sec and cache misses of a queue
+*/
+template<typename Queue>
+bool benchSPSC(const char* name_, size_t numEvents_)
+{
+    auto q{std::make_unique<Queue>()};
+    size_t pulledSum{0};
+    cacheCounters counters;
+    std::atomic<bool> sync{false};
+
+    std::thread pusher{[&q, &sync, numEvents_](){
+        while(!sync.load(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+        for (size_t i = 0 ; i < numEvents_ ; ++i)
+        {
+            q->push(i);
+        }
+    }};
+    std::thread puller{[&q, &sync, &pulledSum, numEvents_](){
+        while(!sync.load(std::memory_order_acquire))
+        {
+            std::this_thread::yield();
+        }
+        for (size_t i = 0 ; i < numEvents_ ; ++i)
+        {
+            size_t v{0};
+            q->pop(v);
+            pulledSum += v;
+        }
+    }};
+
+    counters.start();
+    const auto start{std::chrono::steady_clock::now()};
+    sync.store(true, std::memory_order_release);
+    pusher.join();
+    puller.join();
+    const auto timeUs{std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()};
+    counters.stop();
+
+    const bool res{pulledSum == numEvents_ * (numEvents_ - 1) / 2};
+    std::cout << name_ << ": events: " << numEvents_
+              << ", ops per sec: " << numEvents_ * 1'000'000 / static_cast<size_t>(timeUs + 1);
+    counters.print(std::cout);
+    std::cout << ", res: " << res << std::endl;
+    return res;
+}
+
+bool testSPSC2CachedIndices()
+{
+    std::cout << __FUNCTION__ << " Test : ops/sec with and without the cached indices" << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+
+    // yields when full/empty so it finishes on a machine with less cores than threads
+    constexpr size_t queueSize{4096};
+    const size_t numEvents{1024 * 1024 * 4};
+    using waitStrategy = concurency::yieldWait;
+
+    if (!benchSPSC<QueueSPSCUncached<size_t, queueSize, waitStrategy>>("uncached indices", numEvents))
+        return false;
+    if (!benchSPSC<concurency_2026::QueueSPSC<size_t, queueSize, waitStrategy>>("cached indices  ", numEvents))
+        return false;
+    std::cout << std::endl;
+    return true;
+}
+
+/*
+    a multi kilobyte record, filled and checked in place by the zero copy test
+*/
+struct BigRecord
+{
+    size_t _id{0};
+    std::array<size_t, 511> _payload{};
+
+    void fill(size_t id_)
+    {
+        _id = id_;
+        for (size_t i = 0 ; i < _payload.size() ; ++i)
+        {
+            _payload[i] = id_ + i;
+        }
+    }
+    bool check(size_t id_) const
+    {
+        if (_id != id_)
+            return false;
+        for (size_t i = 0 ; i < _payload.size() ; ++i)
+        {
+            if (_payload[i] != id_ + i)
+                return false;
+        }
+        return true;
+    }
+};
+
+/*
+    zeroCopy - reserve/commit and peek/release, otherwise push/pop of a record built on the stack
+*/
+template<bool zeroCopy>
+bool testSPSC2Records(size_t numEvents_)
+{
+    using Queue = concurency_2026::QueueSPSC<BigRecord, 64, concurency::yieldWait>;
+    auto q{std::make_unique<Queue>()};
+    std::atomic<bool> res{true};
+
+    const auto start{std::chrono::steady_clock::now()};
+    std::thread pusher{[&q, numEvents_](){
+        for (size_t i = 0 ; i < numEvents_ ; ++i)
+        {
+            if constexpr (zeroCopy)
+            {
+                q->reserve().fill(i);
+                q->commit();
+            }
+            else
+            {
+                BigRecord r;
+                r.fill(i);
+                q->push(std::move(r));
+            }
+        }
+    }};
+    std::thread puller{[&q, &res, numEvents_](){
+        auto r{std::make_unique<BigRecord>()};
+        for (size_t i = 0 ; i < numEvents_ ; ++i)
+        {
+            const BigRecord* elem{nullptr};
+            if constexpr (zeroCopy)
+            {
+                while ((elem = q->peek()) == nullptr)
+                {
+                    std::this_thread::yield();
+                }
+            }
+            else
+            {
+                q->pop(*r);
+                elem = r.get();
+            }
+
+            if (!elem->check(i))
+            {
+                std::cerr << "Poller error: expected: " << i << ", received: " << elem->_id << std::endl;
+                res = false;
+            }
+            if constexpr (zeroCopy)
+            {
+                q->release();
+            }
+            if (!res)
+                return;
+        }
+    }};
+    pusher.join();
+    puller.join();
+    const auto timeUs{std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()};
+
+    std::cout << (zeroCopy ? "reserve/commit, peek/release" : "push/pop                    ")
+              << ": records of " << sizeof(BigRecord) << " bytes: " << numEvents_
+              << ", ops per sec: " << numEvents_ * 1'000'000 / static_cast<size_t>(timeUs + 1)
+              << ", res: " << res << std::endl;
+    return res;
+}
+
+bool testSPSC2ZeroCopy()
+{
+    std::cout << __FUNCTION__ << " Test : zero copy reserve/commit, peek/release" << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+
+    concurency_2026::QueueSPSC<Node, 2> q;
+    if (q.peek() != nullptr)
+    {
+        std::cerr << __FUNCTION__ << ':' << __LINE__ << " peek of an empty queue" << std::endl;
+        return false;
+    }
+    q.reserve()._id = 7;
+    q.commit();
+    const Node* elem{q.peek()};
+    if (elem == nullptr || elem->_id != 7 || q.peek() != elem)
+    {
+        std::cerr << __FUNCTION__ << ':' << __LINE__ << " expected 7 until release" << std::endl;
+        return false;
+    }
+    q.release();
+    if (q.peek() != nullptr || !q.empty())
+    {
+        std::cerr << __FUNCTION__ << ':' << __LINE__ << " expected empty after release" << std::endl;
+        return false;
+    }
+
+    const size_t numEvents{100'000};
+    if (!testSPSC2Records<false>(numEvents))
+        return false;
+    if (!testSPSC2Records<true>(numEvents))
+        return false;
+    std::cout << std::endl;
+    return true;
+}
+
+/*
+    a market tick sized element, trivially constructible so nothing touches the ring before the first pass
+*/
+struct Tick
+{
+    size_t _fields[8];
+};
+
+/*
+    latency of every push of the first pass through an empty ring, that is where the page faults are
+*/
+template<typename Queue>
+bool startupLatency(const char* name_, Queue& q_)
+{
+    constexpr size_t numEvents{Queue::capacity};
+    std::vector<uint32_t> latenciesNs(numEvents);
+
+    for (size_t i = 0 ; i < numEvents ; ++i)
+    {
+        const auto start{std::chrono::steady_clock::now()};
+        q_.push(Tick{{i}});
+        latenciesNs[i] = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    // the elements are in place
+    for (size_t i = 0 ; i < numEvents ; ++i)
+    {
+        Tick elem;
+        q_.pop(elem);
+        if (elem._fields[0] != i)
+        {
+            std::cerr << name_ << ": expected: " << i << ", received: " << elem._fields[0] << std::endl;
+            return false;
+        }
+    }
+
+    std::sort(latenciesNs.begin(), latenciesNs.end());
+    std::cout << name_ << ": first pass of " << numEvents << " pushes, p50 ns: " << latenciesNs[numEvents / 2]
+              << ", p99 ns: " << latenciesNs[numEvents * 99 / 100]
+              << ", p99.9 ns: " << latenciesNs[numEvents * 999 / 1000]
+              << ", max ns: " << latenciesNs.back() << std::endl;
+    return true;
+}
+
+template<size_t N>
+struct StartupQueue : concurency_2026::QueueSPSC<Tick, N, concurency::pauseWait, concurency_2026::AllocatedBuffer>
+{
+    static constexpr size_t capacity{N};
+    using concurency_2026::QueueSPSC<Tick, N, concurency::pauseWait, concurency_2026::AllocatedBuffer>::QueueSPSC;
+};
+
+bool testSPSC2Startup()
+{
+    std::cout << __FUNCTION__ << " Test : first pass latency by memory placement" << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+
+    // 16MB of ring
+    constexpr size_t queueSize{1024 * 256};
+    using concurency_2026::HugePages;
+    struct
+    {
+        const char* _name;
+        concurency_2026::MemoryOptions _opts;
+    } const cases[]{
+        {"heap                       ", {HugePages::no, false, false}},
+        {"heap, prefault             ", {HugePages::no, true, false}},
+        {"transparent huge pages     ", {HugePages::transparent, false, false}},
+        {"hugetlb, prefault, mlock   ", {HugePages::hugetlb, true, true}},
+    };
+    for (const auto& c : cases)
+    {
+        auto q{std::make_unique<StartupQueue<queueSize>>(c._opts)};
+        if (!startupLatency(c._name, *q))
+            return false;
+        std::cout << "    huge pages: " << static_cast<int>(q->buffer().hugePages()) << ", locked: " << q->buffer().locked();
+        if (q->buffer().lockError() != 0)
+            std::cout << ", mlock failed: " << std::strerror(q->buffer().lockError());
+        std::cout << std::endl;
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+template<size_t Bytes>
+struct Pod
+{
+    size_t _fields[Bytes / sizeof(size_t)];
+};
+
+/*
+    bulk - push_bulk/pop_bulk of Batch elements, otherwise push/pop one by one
+*/
+template<typename T, bool bulk>
+bool benchSPSC2Pod(size_t numEvents_)
+{
+    static constexpr size_t Batch{64};
+    using Queue = concurency_2026::QueueSPSC<T, 4096, concurency::yieldWait>;
+    auto q{std::make_unique<Queue>()};
+    std::atomic<bool> res{true};
+
+    const auto start{std::chrono::steady_clock::now()};
+    std::thread pusher{[&q, numEvents_](){
+        T batch[Batch];
+        for (size_t i = 0 ; i < numEvents_ ; )
+        {
+            if constexpr (bulk)
+            {
+                const size_t n{std::min(Batch, numEvents_ - i)};
+                for (size_t j = 0 ; j < n ; ++j)
+                {
+                    batch[j]._fields[0] = i + j;
+                }
+                for (size_t pushed = 0 ; pushed < n ; )
+                {
+                    const size_t cnt{q->push_bulk(batch + pushed, n - pushed)};
+                    if (cnt == 0)
+                        std::this_thread::yield();
+                    pushed += cnt;
+                }
+                i += n;
+            }
+            else
+            {
+                batch[0]._fields[0] = i++;
+                q->push(batch[0]);
+            }
+        }
+    }};
+    std::thread puller{[&q, &res, numEvents_](){
+        T batch[Batch];
+        for (size_t i = 0 ; i < numEvents_ ; )
+        {
+            size_t n{1};
+            if constexpr (bulk)
+            {
+                n = q->pop_bulk(batch, Batch);
+                if (n == 0)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+            }
+            else
+            {
+                q->pop(batch[0]);
+            }
+            for (size_t j = 0 ; j < n ; ++j, ++i)
+            {
+                if (batch[j]._fields[0] != i)
+                {
+                    std::cerr << "Poller error: expected: " << i << ", received: " << batch[j]._fields[0] << std::endl;
+                    res = false;
+                    return;
+                }
+            }
+        }
+    }};
+    pusher.join();
+    puller.join();
+    const auto timeUs{std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()};
+
+    std::cout << (bulk ? "push_bulk/pop_bulk" : "push/pop          ")
+              << ": " << sizeof(T) << " byte pods: " << numEvents_
+              << ", ops per sec: " << numEvents_ * 1'000'000 / static_cast<size_t>(timeUs + 1)
+              << ", res: " << res << std::endl;
+    return res;
+}
+
+bool testSPSC2Bulk()
+{
+    std::cout << __FUNCTION__ << " Test : push_bulk/pop_bulk of trivially copyable types" << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+
+    // partial copies and a wrap around the end of the ring
+    concurency_2026::QueueSPSC<size_t, 8> q;
+    const size_t in[]{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    size_t out[11]{};
+    if (q.push_bulk(in, 5) != 5 || q.pop_bulk(out, 11) != 5 || q.pop_bulk(out, 11) != 0)
+    {
+        std::cerr << __FUNCTION__ << ':' << __LINE__ << " expected 5 pushed and popped" << std::endl;
+        return false;
+    }
+    if (q.push_bulk(in, 11) != 8 || q.push_bulk(in, 1) != 0)
+    {
+        std::cerr << __FUNCTION__ << ':' << __LINE__ << " expected 8 pushed to a ring of 8" << std::endl;
+        return false;
+    }
+    if (q.pop_bulk(out, 3) != 3 || q.pop_bulk(out + 3, 11) != 5 || !q.empty())
+    {
+        std::cerr << __FUNCTION__ << ':' << __LINE__ << " expected 8 popped" << std::endl;
+        return false;
+    }
+    for (size_t i = 0 ; i < 8 ; ++i)
+    {
+        if (out[i] != i)
+        {
+            std::cerr << __FUNCTION__ << ':' << __LINE__ << " expected: " << i << ", received: " << out[i] << std::endl;
+            return false;
+        }
+    }
+
+    const size_t numEvents{1024 * 1024 * 4};
+    if (!benchSPSC2Pod<Pod<16>, false>(numEvents) || !benchSPSC2Pod<Pod<16>, true>(numEvents))
+        return false;
+    if (!benchSPSC2Pod<Pod<64>, false>(numEvents) || !benchSPSC2Pod<Pod<64>, true>(numEvents))
+        return false;
+    std::cout << std::endl;
+    return true;
+}
 
 bool testSPSC2()
 {
@@ -140,6 +677,14 @@ bool testSPSC2()
 
 int main(int /*argc*/, char* /*argv*/[])
 {
+	if (!testSPSC2CachedIndices())
+		return __LINE__;
+	if (!testSPSC2ZeroCopy())
+		return __LINE__;
+	if (!testSPSC2Startup())
+		return __LINE__;
+	if (!testSPSC2Bulk())
+		return __LINE__;
 	if (!testSPSC2())
 		return __LINE__;
     return 0;
@@ -13,6 +13,7 @@ struct stats
 	std::atomic<size_t> pushSum{ 0 };
 	std::atomic<size_t> totalPull{ 0 };
 	std::atomic<size_t> pullSum{ 0 };
+	std::atomic<size_t> torn{ 0 }; // popped nodes that failed verify()
 
 	void reset()
 	{
@@ -20,6 +21,7 @@ struct stats
 		pushSum.store(0);
 		totalPull.store(0);
 		pullSum.store(0);
+		torn.store(0);
 	}
 };
 
@@ -126,7 +128,10 @@ void popFunc(queue_t& q, std::atomic<bool>& end, stats& stats, std::mutex& mtx)
 			stats.pullSum += lastPop;
 
 			if (!n.verify())
+			{
+				stats.torn++;
 				std::cout << "poper: verification failed" << std::endl;
+			}
 		}
 		else
 			bad_pop++;
@@ -136,4 +141,82 @@ void popFunc(queue_t& q, std::atomic<bool>& end, stats& stats, std::mutex& mtx)
 
 	std::lock_guard<std::mutex> l(mtx);
 	std::cout << "poper: good_pops: " << good_pop << ", bad_pops: " << bad_pop << ", last pop: " << lastPop << std::endl;
-}
\ No newline at end of file
+}
+
+/*
+	burst versions of pushFunc/popFunc, for queues with push_n/pop_n
+*/
+template <class queue_t>
+void pushNFunc(queue_t& q, std::atomic<bool>& end, std::atomic<size_t>& val2push, stats& stats, std::mutex& mtx, size_t burst)
+{
+	size_t good_push{ 0 }, bad_push{ 0 };
+	size_t lastPushed{ 0 };
+	size_t pushSum{ 0 }; // added to stats once, the atomic per item would hide the gain of the burst
+
+	std::vector<testNode> nodes;
+	size_t pushed{ 0 };
+	while (!end.load())
+	{
+		if (pushed == nodes.size())
+		{
+			// next burst
+			const size_t val = val2push.fetch_add(burst);
+			nodes.clear();
+			for (size_t i = 0; i < burst; ++i)
+				nodes.emplace_back(val + i);
+			pushed = 0;
+		}
+
+		const size_t n = q.push_n(nodes.begin() + pushed, nodes.end());
+		if (n > 0)
+		{
+			for (size_t i = pushed; i < pushed + n; ++i)
+				pushSum += nodes[i].val();
+			pushed += n;
+			lastPushed = nodes[pushed - 1].val();
+			good_push += n;
+		}
+		else
+			bad_push++;
+	}
+
+	stats.totalPush += good_push;
+	stats.pushSum += pushSum;
+
+	std::lock_guard<std::mutex> l(mtx);
+	std::cout << "burst pusher: good_pushs: " << good_push << ", bad_pushs: " << bad_push << ", last pushed: " << lastPushed << std::endl;
+}
+
+template <class queue_t>
+void popNFunc(queue_t& q, std::atomic<bool>& end, stats& stats, std::mutex& mtx, size_t burst)
+{
+	size_t lastPop{ 0 };
+
+	std::vector<testNode> nodes(burst);
+	size_t good_pop{ 0 }, bad_pop{ 0 };
+	size_t pullSum{ 0 };
+	while (!end.load())
+	{
+		const size_t n = q.pop_n(nodes.begin(), nodes.size());
+		if (n > 0)
+		{
+			for (size_t i = 0; i < n; ++i)
+			{
+				lastPop = nodes[i].val();
+				pullSum += lastPop;
+
+				if (!nodes[i].verify())
+					std::cout << "burst poper: verification failed" << std::endl;
+			}
+			good_pop += n;
+		}
+		else
+			bad_pop++;
+	}
+
+	stats.totalPull += good_pop;
+	stats.pullSum += pullSum;
+
+	std::lock_guard<std::mutex> l(mtx);
+	std::cout << "burst poper: good_pops: " << good_pop << ", bad_pops: " << bad_pop << ", last pop: " << lastPop << std::endl;
+}
@@ -1,7 +1,10 @@
 #include "lockfreeQueue.h"
 
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <string>
+#include <vector>
 
 
 template<typename Q, typename T>
@@ -37,6 +40,152 @@ bool testInterface(const T& origVal, const T& defaultVal)
 	return res;
 }
 
+template<typename Q>
+bool testBulkInterface()
+{
+	std::cout << __FUNCTION__ << " Test : push_n/pop_n " << typeid(Q).name() << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+	Q q;
+	std::vector<int> in(20);
+	for (size_t i = 0; i < in.size(); ++i)
+		in[i] = static_cast<int>(i);
+
+	// only part of the range fits
+	const size_t pushed = q.push_n(in.begin(), in.end());
+	if (pushed == 0 || pushed >= in.size())
+	{
+		std::cout << __FUNCTION__ << ":" << __LINE__ << " unexpected number of pushed: " << pushed << std::endl;
+		return false;
+	}
+
+	std::vector<int> out;
+	while (out.size() < pushed)
+	{
+		if (q.pop_n(std::back_inserter(out), 3) == 0)
+		{
+			std::cout << __FUNCTION__ << ":" << __LINE__ << " queue is empty after " << out.size() << " of " << pushed << std::endl;
+			return false;
+		}
+	}
+	if (q.pop_n(std::back_inserter(out), 3) != 0)
+	{
+		std::cout << __FUNCTION__ << ":" << __LINE__ << " queue is not empty" << std::endl;
+		return false;
+	}
+
+	for (size_t i = 0; i < out.size(); ++i)
+	{
+		if (out[i] != in[i])
+		{
+			std::cout << __FUNCTION__ << ":" << __LINE__ << " poped vals don't match the pushed ones at " << i << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// the test functions default construct their queue
+template<typename Q, size_t Capacity>
+struct sizedHeapQueue : Q
+{
+	sizedHeapQueue() : Q(Capacity, 0) {}
+};
+
+bool testHeapCapacity()
+{
+	std::cout << __FUNCTION__ << " Test : heap queue capacity" << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+	// 10 + 2 + 1 slots are rounded up to 16
+	concurency::m2oHeapQueue<int> q{ 10, 2 };
+	if (q.capacity() != 16 - 2 - 1)
+	{
+		std::cout << __FUNCTION__ << ":" << __LINE__ << " unexpected capacity: " << q.capacity() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// not default constructible, counts the live objects
+struct counted
+{
+	static inline int s_alive{ 0 };
+
+	explicit counted(int v) : val(v) { ++s_alive; }
+	counted(const counted& rHnd) : val(rHnd.val) { ++s_alive; }
+	counted(counted&& rHnd) : val(rHnd.val) { ++s_alive; }
+	counted& operator=(const counted&) = default;
+	counted& operator=(counted&&) = default;
+	~counted() { --s_alive; }
+
+	int val;
+};
+
+template<typename Q>
+bool testEmplaceInterface()
+{
+	std::cout << __FUNCTION__ << " Test : emplace/try_pop " << typeid(Q).name() << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+	{
+		Q q;
+		if (counted::s_alive != 0)
+		{
+			std::cout << __FUNCTION__ << ":" << __LINE__ << " the queue constructed values: " << counted::s_alive << std::endl;
+			return false;
+		}
+
+		q.emplace(1);
+		q.emplace(2);
+		q.emplace(3);
+
+		auto v = q.try_pop();
+		if (!v || v->val != 1)
+		{
+			std::cout << __FUNCTION__ << ":" << __LINE__ << " try_pop failed" << std::endl;
+			return false;
+		}
+		// v and 2 values in the queue
+		if (counted::s_alive != 3)
+		{
+			std::cout << __FUNCTION__ << ":" << __LINE__ << " unexpected number of values: " << counted::s_alive << std::endl;
+			return false;
+		}
+	}
+
+	// the queue destroyed the values it still had
+	if (counted::s_alive != 0)
+	{
+		std::cout << __FUNCTION__ << ":" << __LINE__ << " values leaked: " << counted::s_alive << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+template<typename Q>
+bool testMoveOnlyInterface()
+{
+	std::cout << __FUNCTION__ << " Test : move only " << typeid(Q).name() << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+	Q q;
+	q.push(std::make_unique<int>(42));
+	q.emplace(new int(43));
+
+	std::unique_ptr<int> v;
+	q.pop(v);
+	auto v2 = q.try_pop();
+	if (!v || *v != 42 || !v2 || !*v2 || **v2 != 43 || q.try_pop())
+	{
+		std::cout << __FUNCTION__ << ":" << __LINE__ << " poped vals don't match the pushed ones" << std::endl;
+		return false;
+	}
+	return true;
+}
+
 
 struct node
 {
@@ -68,5 +217,36 @@ int main(int /*argc*/, char* /*argv*/[])
 		return __LINE__;
 	if (!testInterface<concurency::m2oQueue<node, 12, 0>, node>(node("1"), node("42")))
 		return __LINE__;
+
+	if (!testInterface<sizedHeapQueue<concurency::m2oHeapQueue<std::string>, 12>, std::string>("1", "42"))
+		return __LINE__;
+	if (!testInterface<sizedHeapQueue<concurency::m2mHeapQueue<node, concurency::commitMode::perSlot>, 12>, node>(node("1"), node("42")))
+		return __LINE__;
+	if (!testHeapCapacity())
+		return __LINE__;
+
+	if (!testEmplaceInterface<concurency::m2oQueue<counted, 12, 0>>())
+		return __LINE__;
+	if (!testEmplaceInterface<concurency::m2mQueue<counted, 12, 0, concurency::commitMode::perSlot>>())
+		return __LINE__;
+	if (!testEmplaceInterface<sizedHeapQueue<concurency::m2mHeapQueue<counted, concurency::commitMode::ordered>, 12>>())
+		return __LINE__;
+	if (!testMoveOnlyInterface<concurency::m2oQueue<std::unique_ptr<int>, 12, 0>>())
+		return __LINE__;
+	if (!testMoveOnlyInterface<sizedHeapQueue<concurency::m2mHeapQueue<std::unique_ptr<int>, concurency::commitMode::perSlot>, 12>>())
+		return __LINE__;
+
+	if (!testBulkInterface<concurency::m2oQueue<int, 12, 0>>())
+		return __LINE__;
+	if (!testBulkInterface<concurency::m2oQueue<int, 12, 0, concurency::commitMode::perSlot>>())
+		return __LINE__;
+	if (!testBulkInterface<concurency::m2mQueue<int, 12, 0, concurency::commitMode::ordered>>())
+		return __LINE__;
+	if (!testBulkInterface<concurency::m2mQueue<int, 12, 0, concurency::commitMode::perSlot>>())
+		return __LINE__;
+	if (!testBulkInterface<sizedHeapQueue<concurency::m2oHeapQueue<int>, 12>>())
+		return __LINE__;
+	if (!testBulkInterface<sizedHeapQueue<concurency::m2mHeapQueue<int, concurency::commitMode::perSlot>, 12>>())
+		return __LINE__;
 	return 0;
 }
\ No newline at end of file
@@ -8,6 +8,8 @@
 
 
 constexpr const size_t threadNum{ 8 };
+constexpr const size_t sweepProducersNum{ 4 };
+constexpr const size_t sweepMaxConsumersNum{ 32 };
 
 template<typename queue_t>
 bool testPushPop()
@@ -134,6 +136,121 @@ bool testPush_1threadPop()
 	return res;
 }
 
+template<typename queue_t>
+bool testPushPopBurst(size_t burst)
+{
+	std::cout << " Test : many threads push bursts of " << burst << ", many threads pull bursts, queue: " << typeid(queue_t).name() << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+	queue_t q;
+	stats stats;
+
+	std::atomic<size_t> val2push{ 0 };
+	std::atomic<bool> endPush{ false };
+	std::atomic<bool> endPop{ false };
+	std::mutex mtx;
+
+	std::vector<std::thread> threads; threads.resize(threadNum);
+	for (size_t i = 0; i < threads.size() / 2; i++)
+		threads[i] = std::thread([&q, &endPop, &stats, &mtx, burst]() { popNFunc<queue_t>(q, endPop, stats, mtx, burst); });
+	for (size_t i = threads.size() / 2; i < threads.size(); i++)
+		threads[i] = std::thread([&q, &endPush, &val2push, &stats, &mtx, burst]() { pushNFunc<queue_t>(q, endPush, val2push, stats, mtx, burst); });
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+	endPush.store(true);
+	std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+	endPop.store(true);
+
+	for (auto& t : threads)
+		t.join();
+
+	std::cout << std::endl;
+	std::cout << "totalPops: " << stats.totalPull.load() << ", total push: " << stats.totalPush.load() << " , verdict : " << (stats.totalPush.load() == stats.totalPull.load() ? "OK" : "FAIL") << std::endl;
+	std::cout << "pushed sum: " << stats.pushSum.load() << ", pulled sum: " << stats.pullSum.load() << " , verdict : " << (stats.pushSum.load() == stats.pullSum.load() ? "OK" : "FAIL") << std::endl;
+
+	std::cout << " ---- End ----" << std::endl << std::endl << std::endl;
+
+	bool res = (stats.totalPush.load() == stats.totalPull.load()) && (stats.pushSum.load() == stats.pullSum.load());
+	return res;
+}
+
+template<typename queue_t>
+bool testConsumersNum(size_t consumersNum, size_t& popsPerSec)
+{
+	std::cout << " Test : " << sweepProducersNum << " threads push, " << consumersNum << " threads pull, queue: " << typeid(queue_t).name() << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+	queue_t q;
+	stats stats;
+
+	std::atomic<size_t> val2push{ 0 };
+	std::atomic<bool> endPush{ false };
+	std::atomic<bool> endPop{ false };
+	std::mutex mtx;
+
+	std::vector<std::thread> threads; threads.resize(sweepProducersNum + consumersNum);
+	for (size_t i = 0; i < consumersNum; i++)
+		threads[i] = std::thread([&q, &endPop, &stats, &mtx]() { popFunc<queue_t>(q, endPop, stats, mtx); });
+	for (size_t i = consumersNum; i < threads.size(); i++)
+		threads[i] = std::thread([&q, &endPush, &val2push, &stats, &mtx]() { pushFunc<queue_t>(q, endPush, val2push, stats, mtx); });
+
+	const auto start{ std::chrono::steady_clock::now() };
+	std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+	endPush.store(true);
+	const auto pushTime{ std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start) };
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	endPop.store(true);
+
+	for (auto& t : threads)
+		t.join();
+
+	std::cout << std::endl;
+	std::cout << "totalPops: " << stats.totalPull.load() << ", total push: " << stats.totalPush.load() << " , verdict : " << (stats.totalPush.load() == stats.totalPull.load() ? "OK" : "FAIL") << std::endl;
+	std::cout << "pushed sum: " << stats.pushSum.load() << ", pulled sum: " << stats.pullSum.load() << " , verdict : " << (stats.pushSum.load() == stats.pullSum.load() ? "OK" : "FAIL") << std::endl;
+	std::cout << "torn nodes: " << stats.torn.load() << " , verdict : " << (stats.torn.load() == 0 ? "OK" : "FAIL") << std::endl;
+	popsPerSec = stats.totalPull.load() * 1000 / static_cast<size_t>(pushTime.count() + 1);
+	std::cout << "consumers: " << consumersNum << ", pops per sec: " << popsPerSec << std::endl;
+
+	std::cout << " ---- End ----" << std::endl << std::endl << std::endl;
+
+	bool res = (stats.totalPush.load() == stats.totalPull.load()) && (stats.pushSum.load() == stats.pullSum.load()) && stats.torn.load() == 0;
+	return res;
+}
+
+/*
+	the same producers against 1, 2, 4 ... consumers, ordered vs perSlot commit, one table at the end
+*/
+template<typename orderedQueue_t, typename perSlotQueue_t>
+bool testConsumersSweep()
+{
+	struct row
+	{
+		size_t consumers;
+		size_t ordered;
+		size_t perSlot;
+	};
+	std::vector<row> rows;
+	for (size_t consumersNum = 1; consumersNum <= sweepMaxConsumersNum; consumersNum *= 2)
+	{
+		row r{ consumersNum, 0, 0 };
+		if (!testConsumersNum<orderedQueue_t>(consumersNum, r.ordered))
+			return false;
+		if (!testConsumersNum<perSlotQueue_t>(consumersNum, r.perSlot))
+			return false;
+		rows.push_back(r);
+	}
+
+	auto ratio{ [](size_t a, size_t b) { return static_cast<double>(a) / static_cast<double>(b == 0 ? 1 : b); } };
+	std::cout << sweepProducersNum << " producers, pops per sec, scaling is against 1 consumer" << std::endl;
+	std::cout << "consumers\tordered\tperSlot\tperSlot/ordered\tordered scaling\tperSlot scaling" << std::endl;
+	for (const auto& r : rows)
+	{
+		std::cout << r.consumers << "\t" << r.ordered << "\t" << r.perSlot << "\t" << ratio(r.perSlot, r.ordered)
+				  << "\t" << ratio(r.ordered, rows.front().ordered) << "\t" << ratio(r.perSlot, rows.front().perSlot) << std::endl;
+	}
+	std::cout << std::endl;
+	return true;
+}
 
 int main(int argc, char* argv[])
 {
@@ -149,7 +266,7 @@ int main(int argc, char* argv[])
 			return __LINE__;
 	}
 
-	using m2mQueue_t = concurency::m2mQueue<testNode, 128, threadNum>;
+	using m2mQueue_t = concurency::m2mQueue<testNode, 128, threadNum, concurency::commitMode::ordered>;
 
 	if (!testPushPop<m2mQueue_t>())
 		return __LINE__;
@@ -158,6 +275,30 @@ int main(int argc, char* argv[])
 	if (!testPush_1threadPop<m2mQueue_t>())
 		return __LINE__;
 
+	using m2mQueuePerSlot_t = concurency::m2mQueue<testNode, 128, threadNum, concurency::commitMode::perSlot>;
+
+	if (!testPushPop<m2mQueuePerSlot_t>())
+		return __LINE__;
+	if (!testPopPush<m2mQueuePerSlot_t>())
+		return __LINE__;
+	if (!testPush_1threadPop<m2mQueuePerSlot_t>())
+		return __LINE__;
+
+	// throughput has to grow with the number of consumers, not flatten
+	using m2mQueueSweep_t = concurency::m2mQueue<testNode, 128, sweepProducersNum, concurency::commitMode::ordered>;
+	using m2mQueueSweepPerSlot_t = concurency::m2mQueue<testNode, 128, sweepProducersNum, concurency::commitMode::perSlot>;
+
+	if (!testConsumersSweep<m2mQueueSweep_t, m2mQueueSweepPerSlot_t>())
+		return __LINE__;
+
+	using m2mQueueBurst_t = concurency::m2mQueue<testNode, 1024, threadNum, concurency::commitMode::ordered>;
+	using m2mQueueBurstPerSlot_t = concurency::m2mQueue<testNode, 1024, threadNum, concurency::commitMode::perSlot>;
+
+	if (!testPushPopBurst<m2mQueueBurst_t>(64))
+		return __LINE__;
+	if (!testPushPopBurst<m2mQueueBurstPerSlot_t>(64))
+		return __LINE__;
+
 	return 0;
 }
 
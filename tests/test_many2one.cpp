@@ -7,6 +7,8 @@
 #include <thread>
 
 constexpr const size_t threadNum{8};
+// more producers than cores, some of them get preempted between claiming a slot and committing it
+constexpr const size_t oversubscribedThreadNum{32};
 
 template<typename queue_t>
 bool testPushPull()
@@ -90,6 +92,90 @@ bool testPullPush()
 	return res;
 }
 
+template<typename queue_t>
+bool testOversubscribed(size_t producersNum)
+{
+	std::cout << " Test : " << producersNum << " producers on " << std::thread::hardware_concurrency() << " cores, one thread pulls, queue: " << typeid(queue_t).name() << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+	queue_t q;
+	stats stats;
+
+	std::atomic<size_t> val2push{ 0 };
+	std::atomic<bool> endPush{ false };
+	std::atomic<bool> endPop{ false };
+	std::mutex mtx;
+
+	std::vector<std::thread> threads; threads.resize(producersNum + 1);
+	threads[0] = std::thread([&q, &endPop, &stats, &mtx]() { popFunc<queue_t>(q, endPop, stats, mtx); });
+	for (size_t i = 1; i < threads.size(); i++)
+	{
+		threads[i] = std::thread([&q, &endPush, &val2push, &stats, &mtx]() { pushFunc<queue_t>(q, endPush, val2push, stats, mtx); });
+	}
+
+	const auto start{ std::chrono::steady_clock::now() };
+	std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+	endPush.store(true);
+	const auto pushTime{ std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start) };
+	std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+	endPop.store(true);
+
+	for (auto& t : threads)
+		t.join();
+
+	std::cout << std::endl;
+	std::cout << "totalPops: " << stats.totalPull.load() << ", total push: " << stats.totalPush.load() << " , verdict : " << (stats.totalPush.load() == stats.totalPull.load() ? "OK" : "FAIL") << std::endl;
+	std::cout << "pushed sum: " << stats.pushSum.load() << ", pulled sum: " << stats.pullSum.load() << " , verdict : " << (stats.pushSum.load() == stats.pullSum.load() ? "OK" : "FAIL") << std::endl;
+	std::cout << "pushs per sec: " << stats.totalPush.load() * 1000 / static_cast<size_t>(pushTime.count() + 1) << std::endl;
+
+	std::cout << " ---- End ----" << std::endl << std::endl << std::endl;
+
+	bool res = (stats.totalPush.load() == stats.totalPull.load()) && (stats.pushSum.load() == stats.pullSum.load());
+	return res;
+}
+
+template<typename queue_t>
+bool testPushPullBurst(size_t burst)
+{
+	std::cout << " Test : many threads push bursts of " << burst << ", one thread pulls bursts, queue: " << typeid(queue_t).name() << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+	queue_t q;
+	stats stats;
+
+	std::atomic<size_t> val2push{ 0 };
+	std::atomic<bool> endPush{ false };
+	std::atomic<bool> endPop{ false };
+	std::mutex mtx;
+
+	std::vector<std::thread> threads; threads.resize(threadNum);
+	threads[0] = std::thread([&q, &endPop, &stats, &mtx, burst]() { popNFunc<queue_t>(q, endPop, stats, mtx, burst); });
+	for (size_t i = 1; i < threads.size(); i++)
+	{
+		threads[i] = std::thread([&q, &endPush, &val2push, &stats, &mtx, burst]() { pushNFunc<queue_t>(q, endPush, val2push, stats, mtx, burst); });
+	}
+
+	const auto start{ std::chrono::steady_clock::now() };
+	std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+	endPush.store(true);
+	const auto pushTime{ std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start) };
+	std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+	endPop.store(true);
+
+	for (auto& t : threads)
+		t.join();
+
+	std::cout << std::endl;
+	std::cout << "totalPops: " << stats.totalPull.load() << ", total push: " << stats.totalPush.load() << " , verdict : " << (stats.totalPush.load() == stats.totalPull.load() ? "OK" : "FAIL") << std::endl;
+	std::cout << "pushed sum: " << stats.pushSum.load() << ", pulled sum: " << stats.pullSum.load() << " , verdict : " << (stats.pushSum.load() == stats.pullSum.load() ? "OK" : "FAIL") << std::endl;
+	std::cout << "burst: " << burst << ", pushs per sec: " << stats.totalPush.load() * 1000 / static_cast<size_t>(pushTime.count() + 1) << std::endl;
+
+	std::cout << " ---- End ----" << std::endl << std::endl << std::endl;
+
+	bool res = (stats.totalPush.load() == stats.totalPull.load()) && (stats.pushSum.load() == stats.pullSum.load());
+	return res;
+}
+
 int main(int argc, char* argv[])
 {
 	if (argc == 2 && std::string(argv[1]) == "std")
@@ -109,6 +195,51 @@ int main(int argc, char* argv[])
 	if (!testPullPush<m2oQueue_t>())
 		return __LINE__;
 
+	using m2oQueuePerSlot_t = concurency::m2oQueue<testNode, 128, threadNum, concurency::commitMode::perSlot>;
+
+	if (!testPushPull<m2oQueuePerSlot_t>())
+		return __LINE__;
+	if (!testPullPush<m2oQueuePerSlot_t>())
+		return __LINE__;
+
+	// preemption between claim and commit: ordered commits stall behind the preempted producer
+	using m2oQueueOversubscribed_t = concurency::m2oQueue<testNode, 128, oversubscribedThreadNum>;
+	using m2oQueueOversubscribedPerSlot_t = concurency::m2oQueue<testNode, 128, oversubscribedThreadNum, concurency::commitMode::perSlot>;
+
+	if (!testOversubscribed<m2oQueueOversubscribed_t>(oversubscribedThreadNum))
+		return __LINE__;
+	if (!testOversubscribed<m2oQueueOversubscribedPerSlot_t>(oversubscribedThreadNum))
+		return __LINE__;
+
+	// push_n/pop_n, burst of 1 is the one atomic per item baseline
+	using m2oQueueBurst_t = concurency::m2oQueue<testNode, 1024, threadNum>;
+	using m2oQueueBurstPerSlot_t = concurency::m2oQueue<testNode, 1024, threadNum, concurency::commitMode::perSlot>;
+
+	for (size_t burst : {1, 32, 256})
+	{
+		if (!testPushPullBurst<m2oQueueBurst_t>(burst))
+			return __LINE__;
+		if (!testPushPullBurst<m2oQueueBurstPerSlot_t>(burst))
+			return __LINE__;
+	}
+
+	// the same queue sized at runtime, it has to be at least as fast as the compile time one.
+	// both have 1024 slots
+	constexpr size_t heapCapacity{ 1024 - threadNum - 1 };
+	using m2oQueueFixed_t = concurency::m2oQueue<testNode, heapCapacity, threadNum>;
+	struct m2oHeapQueue_t : concurency::m2oHeapQueue<testNode>
+	{
+		m2oHeapQueue_t() : concurency::m2oHeapQueue<testNode>(heapCapacity, threadNum) {}
+	};
+
+	for (size_t burst : {1, 32})
+	{
+		if (!testPushPullBurst<m2oQueueFixed_t>(burst))
+			return __LINE__;
+		if (!testPushPullBurst<m2oHeapQueue_t>(burst))
+			return __LINE__;
+	}
+
 	return 0;
 }
 
@@ -11,6 +11,11 @@
 #include <functional>
 #include <random>
 #include <limits>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sys/wait.h>
+#include <unistd.h>
 
 constexpr static size_t MaxSeqnos{1024 * 1024};
 std::array<std::atomic<size_t>, MaxSeqnos> receivedSeqnos;
@@ -182,6 +187,1311 @@ bool testInterface()
     return true;
 }
 
+bool testReserveCommit(bufferMapping mapping)
+{
+	std::cout << __FUNCTION__ << " Test : reserve/commit, mapping: " << static_cast<int>(mapping) << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+	bufferQueue queue{4000, mapping};
+    std::cout << queue << ", mirrored: " << queue.mirrored() << std::endl;
+    std::string data, expected;
+    size_t pushSeqno{0}, popSeqno{0}, wrapped{0}, copied{0};
+
+    // several laps, so records wrap around the end of the buffer
+    for (size_t round = 0 ; round < 20 ; round++)
+    {
+        while (true)
+        {
+            makeData(pushSeqno % 300, data);
+            const auto spans{queue.reserve(data.size())};
+            if (!spans.valid())
+            {
+                break;
+            }
+            if (spans._first.second + spans._second.second != data.size())
+            {
+                std::cout << __FILE__ << ':' << __LINE__ << " - Error: spans of " << spans._first.second << " + " << spans._second.second
+                          << " bytes for a record of " << data.size() << std::endl;
+                return false;
+            }
+            wrapped += spans._second.second != 0;
+            std::memcpy(spans._first.first, data.data(), spans._first.second);
+            std::memcpy(spans._second.first, data.data() + spans._first.second, spans._second.second);
+            queue.commit();
+            pushSeqno++;
+        }
+
+        // leave some records in, the next round starts in the middle of the buffer
+        while (pushSeqno - popSeqno > 2)
+        {
+            auto [ptr, len] = queue.front(data);
+            copied += ptr == data.c_str();
+            makeData(popSeqno++ % 300, expected);
+            if (expected != std::string_view{ptr, len})
+            {
+                std::cout << __FILE__ << ':' << __LINE__ << " - Error: data mismatch: expected: " << expected << std::endl;
+                return false;
+            }
+            queue.pop();
+        }
+    }
+
+    std::cout << "records: " << pushSeqno << ", wrapped: " << wrapped << ", copied by front: " << copied << std::endl;
+    if (queue.mirrored())
+    {
+        // every record is contiguous
+        return wrapped == 0 && copied == 0;
+    }
+    return wrapped > 0 && copied > 0;
+}
+
+bool testScatterGather()
+{
+	std::cout << __FUNCTION__ << " Test : push of fragments " << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+	bufferQueue queue{1024};
+    std::string data, received;
+    size_t pushSeqno{0}, popSeqno{0};
+
+    // several laps, the fragments are split at the wrap in different places
+    for (size_t round = 0 ; round < 20 ; round++)
+    {
+        while (true)
+        {
+            // a protocol header and a body in 3 fragments, or the same as iovec
+            makeData(pushSeqno % 300, data);
+            const auto third{data.size() / 3};
+            bool pushed{false};
+            if (pushSeqno % 2 == 0)
+            {
+                const std::pair<const char*, size_t> fragments[]{{data.c_str(), third}, {data.c_str() + third, 0},
+                                                                 {data.c_str() + third, third}, {data.c_str() + 2 * third, data.size() - 2 * third}};
+                pushed = queue.push(fragments, std::size(fragments));
+            }
+            else
+            {
+                iovec fragments[]{{data.data(), third}, {data.data() + third, data.size() - third}};
+                pushed = queue.push(fragments, std::size(fragments));
+            }
+            if (!pushed)
+            {
+                break;
+            }
+            pushSeqno++;
+        }
+
+        while (pushSeqno - popSeqno > 2)
+        {
+            auto [ptr, len] = queue.front(received);
+            makeData(popSeqno++ % 300, data);
+            if (data != std::string_view{ptr, len})
+            {
+                std::cout << __FILE__ << ':' << __LINE__ << " - Error: data mismatch: expected: " << data << std::endl;
+                return false;
+            }
+            queue.pop();
+        }
+    }
+
+    std::cout << "records: " << pushSeqno << std::endl;
+    return true;
+}
+
+/*
+    one producer, one consumer that reads every cache line of a record.
+    MB/s of each payload size with regular and with non-temporal copies into the ring
+*/
+bool testNonTemporal()
+{
+	std::cout << __FUNCTION__ << " Test : regular vs non-temporal copy " << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+    const size_t totalBytes{256 * 1024 * 1024};
+    for (size_t payloadLen = 64 ; payloadLen <= 64 * 1024 ; payloadLen *= 2)
+    {
+        std::cout << "payload: " << payloadLen;
+        for (const auto threshold : {std::numeric_limits<size_t>::max(), size_t{0}})
+        {
+            bufferQueue queue{4 * 1024 * 1024};
+            queue.setNonTemporalThreshold(threshold);
+            const size_t numRecords{totalBytes / payloadLen};
+            bool res{true};
+
+            const auto start{std::chrono::steady_clock::now()};
+            std::thread pusher{[&queue, payloadLen, numRecords](){
+                std::string data(payloadLen, 'A');
+                for (size_t i = 0 ; i < numRecords ; i++)
+                {
+                    std::memcpy(data.data(), &i, sizeof(i));
+                    while (!queue.push(data.c_str(), data.size()))
+                        std::this_thread::yield();
+                }
+            }};
+            std::thread puller{[&queue, &res, payloadLen, numRecords](){
+                std::string buffer;
+                size_t sum{0};
+                for (size_t i = 0 ; i < numRecords ; )
+                {
+                    auto [ptr, len] = queue.front(buffer);
+                    if (ptr == nullptr)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    size_t val{0};
+                    std::memcpy(&val, ptr, sizeof(val));
+                    res = res && len == payloadLen && val == i;
+                    for (size_t off = 0 ; off < len ; off += 64)
+                    {
+                        sum += static_cast<unsigned char>(ptr[off]);
+                    }
+                    queue.pop();
+                    i++;
+                }
+                res = res && sum > 0;
+            }};
+            pusher.join();
+            puller.join();
+            const auto timeUs{std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()};
+
+            std::cout << (threshold == 0 ? ", non-temporal MB/s: " : ", regular MB/s: ") << totalBytes / static_cast<size_t>(timeUs + 1);
+            if (!res)
+            {
+                std::cout << std::endl << __FILE__ << ':' << __LINE__ << " - Error: data mismatch" << std::endl;
+                return false;
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    // streamed payloads that don't start on 16 bytes: compact framing (block + 4) and fragments split anywhere
+    bufferQueueCompact compact{4000};
+    bufferQueue fragmented{4096};
+    compact.setNonTemporalThreshold(0);
+    fragmented.setNonTemporalThreshold(0);
+    std::string data, buffer;
+    for (size_t seqno = 0 ; seqno < 10000 ; seqno++)
+    {
+        makeData(seqno % 300 + 20, data); // at least 20 bytes for the fragments
+        const std::array<std::pair<const char*, size_t>, 3> fragments{{{data.c_str(), 3}, {data.c_str() + 3, 17}, {data.c_str() + 20, data.size() - 20}}};
+        if (!compact.push(data.c_str(), data.size()) || !fragmented.push(fragments.data(), fragments.size()))
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: push failed" << std::endl;
+            return false;
+        }
+        auto [ptr, len] = compact.front(buffer);
+        const std::string first{ptr, len};
+        compact.pop();
+        std::tie(ptr, len) = fragmented.front(buffer);
+        if (first != data || std::string_view{ptr, len} != data)
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: data mismatch: expected: " << data << std::endl;
+            return false;
+        }
+        fragmented.pop();
+    }
+    std::cout << "unaligned streamed records: 10000" << std::endl;
+    return true;
+}
+
+std::string journalPath()
+{
+    return (std::filesystem::temp_directory_path() / ("test_queueBuffer_" + std::to_string(getpid()) + ".journal")).string();
+}
+
+/*
+    a child process pushes and pops, then dies without closing the journal,
+    the records it left must come out of the journal reopened by the parent.
+*/
+bool testJournal()
+{
+	std::cout << __FUNCTION__ << " Test : journal recovery " << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+    const auto path{journalPath()};
+    std::filesystem::remove(path);
+    const size_t capacity{64 * 1024};
+    const size_t popped{50};
+
+    const auto pid{fork()};
+    if (pid == 0)
+    {
+        bufferQueueJournal journal{path, capacity};
+        std::string data;
+        for (size_t seqno = 0 ; ; seqno++)
+        {
+            makeData(seqno % 300, data);
+            if (!journal.push(data.c_str(), data.size()))
+                break;
+        }
+        for (size_t i = 0 ; i < popped ; i++)
+        {
+            journal.pop();
+        }
+        _exit(0);
+    }
+    int status{0};
+    waitpid(pid, &status, 0);
+
+    size_t remaining{0};
+    {
+        bufferQueueJournal journal{path, capacity};
+        std::cout << journal << std::endl;
+        std::string data, expected;
+        for (size_t seqno = popped ; !journal.empty() ; seqno++, remaining++)
+        {
+            auto [ptr, len] = journal.front(data);
+            makeData(seqno % 300, expected);
+            if (expected != std::string_view{ptr, len})
+            {
+                std::cout << __FILE__ << ':' << __LINE__ << " - Error: data mismatch: expected: " << expected << std::endl;
+                return false;
+            }
+            // leave some for the next reopen
+            if (journal.recovered() - remaining <= 10)
+                break;
+            journal.pop();
+        }
+        if (remaining + 10 != journal.recovered())
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: recovered: " << journal.recovered() << ", read: " << remaining << std::endl;
+            return false;
+        }
+    }
+
+    // a clean close resumes the same way
+    {
+        bufferQueueJournal journal{path, capacity};
+        std::cout << journal << std::endl;
+        if (journal.recovered() != 10)
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: recovered: " << journal.recovered() << ", expected 10" << std::endl;
+            return false;
+        }
+    }
+
+    // another capacity is refused and the records stay
+    try
+    {
+        bufferQueueJournal journal{path, capacity * 2};
+        std::cout << __FILE__ << ':' << __LINE__ << " - Error: a journal of another capacity was opened" << std::endl;
+        return false;
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << e.what() << std::endl;
+    }
+    {
+        bufferQueueJournal journal{path, capacity};
+        if (journal.recovered() != 10)
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: recovered: " << journal.recovered() << " after a refused open, expected 10" << std::endl;
+            return false;
+        }
+    }
+    std::filesystem::remove(path);
+    return true;
+}
+
+/*
+    time to the first pop after a restart of a full 1GB journal of 1KB records
+*/
+bool benchJournalRestart()
+{
+	std::cout << __FUNCTION__ << " Test : journal restart " << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+    const auto path{journalPath()};
+    std::filesystem::remove(path);
+    const size_t capacity{1024 * 1024 * 1024 - 1};
+    {
+        bufferQueueJournal journal{path, capacity};
+        std::string data(1024, 'A');
+        size_t records{0};
+        while (journal.push(data.c_str(), data.size()))
+        {
+            records++;
+        }
+        std::cout << "filled: " << records << " records" << std::endl;
+    }
+
+    const auto start{std::chrono::steady_clock::now()};
+    bufferQueueJournal journal{path, capacity};
+    std::string data;
+    auto [ptr, len] = journal.front(data);
+    const bool res{ptr != nullptr && len == 1024 && journal.pop()};
+    const auto timeUs{std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()};
+
+    std::cout << "recovered: " << journal.recovered() << " records, time to first pop us: " << timeUs << std::endl;
+    std::filesystem::remove(path);
+    return res;
+}
+
+/*
+    one producer, one consumer, 100 bytes messages.
+    batch - push_batch/consume of up to 64 records, otherwise push/front/pop one by one
+*/
+template<bool batch>
+bool testBatchThroughput(size_t numRecords)
+{
+    static constexpr size_t BatchSize{64};
+    static constexpr size_t MessageLen{100};
+    bufferQueue queue{64 * 1024};
+    std::atomic<bool> res{true};
+
+    const auto start{std::chrono::steady_clock::now()};
+    std::thread pusher{[&queue, numRecords](){
+        std::vector<std::array<char, MessageLen>> data(BatchSize);
+        std::vector<std::pair<const char*, size_t>> records(BatchSize);
+        for (size_t seqno = 0 ; seqno < numRecords ; )
+        {
+            const size_t n{std::min(BatchSize, numRecords - seqno)};
+            for (size_t i = 0 ; i < n ; i++)
+            {
+                const size_t val{seqno + i};
+                std::memcpy(data[i].data(), &val, sizeof(val));
+                records[i] = {data[i].data(), data[i].size()};
+            }
+            if constexpr (batch)
+            {
+                for (size_t pushed = 0 ; pushed < n ; )
+                {
+                    const auto cnt{queue.push_batch(records.data() + pushed, n - pushed)};
+                    if (cnt == 0)
+                        std::this_thread::yield();
+                    pushed += cnt;
+                }
+            }
+            else
+            {
+                for (size_t i = 0 ; i < n ; i++)
+                {
+                    while (!queue.push(records[i].first, records[i].second))
+                        std::this_thread::yield();
+                }
+            }
+            seqno += n;
+        }
+    }};
+    std::thread puller{[&queue, &res, numRecords](){
+        std::string buffer;
+        size_t expected{0};
+        auto check{[&res, &expected](const char* ptr, size_t len){
+            size_t val{0};
+            std::memcpy(&val, ptr, sizeof(val));
+            if (len != MessageLen || val != expected)
+            {
+                std::cout << __FILE__ << ':' << __LINE__ << " - Error: expected: " << expected << ", received: " << val << std::endl;
+                res = false;
+            }
+            expected++;
+        }};
+        while (expected < numRecords && res)
+        {
+            if constexpr (batch)
+            {
+                if (queue.consume(check, BatchSize) == 0)
+                    std::this_thread::yield();
+            }
+            else
+            {
+                auto [ptr, len] = queue.front(buffer);
+                if (ptr == nullptr)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                check(ptr, len);
+                queue.pop();
+            }
+        }
+    }};
+    pusher.join();
+    puller.join();
+    const auto timeUs{std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()};
+
+    std::cout << (batch ? "push_batch/consume" : "push/front/pop    ") << ": records: " << numRecords
+              << ", records per sec: " << numRecords * 1'000'000 / static_cast<size_t>(timeUs + 1) << std::endl;
+    return res && queue.empty();
+}
+
+bool testBatch()
+{
+	std::cout << __FUNCTION__ << " Test : push_batch/consume " << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+    // several laps through a small queue, records wrap
+	bufferQueue queue{1024};
+    std::vector<std::string> data(16);
+    std::vector<std::pair<const char*, size_t>> records(data.size());
+    size_t pushSeqno{0}, popSeqno{0};
+    std::string expected;
+    for (size_t round = 0 ; round < 50 ; round++)
+    {
+        for (size_t i = 0 ; i < data.size() ; i++)
+        {
+            makeData((pushSeqno + i) % 100, data[i]);
+            records[i] = {data[i].c_str(), data[i].size()};
+        }
+        pushSeqno += queue.push_batch(records.data(), records.size());
+
+        const auto consumed{queue.consume([&popSeqno, &expected](const char* ptr, size_t len){
+            makeData(popSeqno++ % 100, expected);
+            if (expected != std::string_view{ptr, len})
+            {
+                std::cout << __FILE__ << ':' << __LINE__ << " - Error: data mismatch: expected: " << expected << std::endl;
+                std::terminate();
+            }
+        }, 5)};
+        if (consumed > 5)
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: consumed " << consumed << " records, max 5" << std::endl;
+            return false;
+        }
+    }
+    popSeqno += queue.consume([](const char*, size_t){});
+    if (popSeqno != pushSeqno || !queue.empty())
+    {
+        std::cout << __FILE__ << ':' << __LINE__ << " - Error: pushed: " << pushSeqno << ", consumed: " << popSeqno << std::endl;
+        return false;
+    }
+
+    const size_t numRecords{2'000'000};
+    return testBatchThroughput<false>(numRecords) && testBatchThroughput<true>(numRecords);
+}
+
+/*
+    records of lengths from a distribution, the same sequence for every queue
+*/
+class messageSizes
+{
+    public:
+    messageSizes(size_t minLen, size_t maxLen): _dist{minLen, maxLen} {}
+
+    size_t next() {return _dist(_mt);}
+
+    private:
+    std::mt19937 _mt{42};
+    std::uniform_int_distribution<size_t> _dist;
+};
+
+template<typename QueueType>
+size_t recordsThatFit(size_t capacity, size_t minLen, size_t maxLen)
+{
+    QueueType queue{capacity};
+    messageSizes sizes{minLen, maxLen};
+    const std::string data(maxLen, 'A');
+    size_t records{0};
+    while (queue.push(data.c_str(), sizes.next()))
+        records++;
+    return records;
+}
+
+template<typename QueueType>
+size_t recordsPerSec(size_t numRecords, size_t minLen, size_t maxLen)
+{
+    QueueType queue{64 * 1024};
+    std::atomic<bool> res{true};
+
+    const auto start{std::chrono::steady_clock::now()};
+    std::thread pusher{[&queue, numRecords, minLen, maxLen](){
+        messageSizes sizes{minLen, maxLen};
+        std::string data(maxLen, 'A');
+        for (size_t seqno = 0 ; seqno < numRecords ; seqno++)
+        {
+            const auto len{sizes.next()};
+            data[0] = static_cast<char>(seqno);
+            while (!queue.push(data.c_str(), len))
+                std::this_thread::yield();
+        }
+    }};
+    messageSizes sizes{minLen, maxLen};
+    std::string buffer;
+    for (size_t seqno = 0 ; seqno < numRecords ; )
+    {
+        auto [ptr, len] = queue.front(buffer);
+        if (ptr == nullptr)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if (len != sizes.next() || ptr[0] != static_cast<char>(seqno))
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: record " << seqno << " of " << len << " bytes" << std::endl;
+            res = false;
+            break;
+        }
+        queue.pop();
+        seqno++;
+    }
+    pusher.join();
+    const auto timeUs{std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()};
+    return res ? numRecords * 1'000'000 / static_cast<size_t>(timeUs + 1) : 0;
+}
+
+bool testCompactFraming()
+{
+	std::cout << __FUNCTION__ << " Test : compact framing " << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+    // several laps with wrapped records, front/pop and consume
+    bufferQueueCompact queue{4000};
+    std::cout << queue << std::endl;
+    std::string data, expected;
+    size_t pushSeqno{0}, popSeqno{0};
+    for (size_t round = 0 ; round < 200 ; round++)
+    {
+        makeData(pushSeqno % 300, data);
+        while (queue.push(data.c_str(), data.size()))
+        {
+            makeData(++pushSeqno % 300, data);
+        }
+        auto check{[&popSeqno, &expected](const char* ptr, size_t len){
+            makeData(popSeqno++ % 300, expected);
+            return expected == std::string_view{ptr, len};
+        }};
+        if (round % 2 == 0)
+        {
+            for (size_t i = 0 ; i < 5 ; i++)
+            {
+                auto [ptr, len] = queue.front(data);
+                if (!check(ptr, len))
+                {
+                    std::cout << __FILE__ << ':' << __LINE__ << " - Error: data mismatch: expected: " << expected << std::endl;
+                    return false;
+                }
+                queue.pop();
+            }
+        }
+        else
+        {
+            bool res{true};
+            queue.consume([&res, &check](const char* ptr, size_t len){ res = check(ptr, len) && res; }, 5);
+            if (!res)
+            {
+                std::cout << __FILE__ << ':' << __LINE__ << " - Error: data mismatch: expected: " << expected << std::endl;
+                return false;
+            }
+        }
+    }
+    std::cout << "records: " << pushSeqno << ", popped: " << popSeqno << std::endl;
+
+    // the same lengths through both framings
+    const size_t capacity{64 * 1024};
+    const size_t numRecords{2'000'000};
+    const std::array<std::pair<size_t, size_t>, 7> distributions{{{8, 8}, {20, 20}, {32, 32}, {64, 64}, {128, 128}, {256, 256}, {8, 256}}};
+    std::cout << "records in a " << capacity / 1024 << "KB ring, records per sec, wide (16 bytes header and blocks) vs compact (4 bytes header, 8 bytes blocks)" << std::endl;
+    for (const auto& [minLen, maxLen] : distributions)
+    {
+        const auto wideRate{recordsPerSec<bufferQueue>(numRecords, minLen, maxLen)};
+        const auto compactRate{recordsPerSec<bufferQueueCompact>(numRecords, minLen, maxLen)};
+        if (wideRate == 0 || compactRate == 0)
+            return false;
+        std::cout << "lengths [" << minLen << ", " << maxLen << "]: records: "
+                  << recordsThatFit<bufferQueue>(capacity, minLen, maxLen) << " vs " << recordsThatFit<bufferQueueCompact>(capacity, minLen, maxLen)
+                  << ", records per sec: " << wideRate << " vs " << compactRate << std::endl;
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+struct heartbeat
+{
+    uint64_t _seqno;
+    uint32_t _source;
+};
+struct order
+{
+    uint64_t _seqno;
+    double _price;
+    uint32_t _quantity;
+    char _side;
+};
+struct quote
+{
+    uint64_t _seqno;
+    std::array<double, 4> _bids;
+    std::array<double, 4> _asks;
+};
+
+/*
+    one producer pushes heartbeats, orders and quotes in turn, the consumer gets them by type
+*/
+template<bool typed>
+bool testTypedThroughput(bufferMapping mapping, size_t numRecords)
+{
+    typedBufferQueue<heartbeat, order, quote> typedQueue{64 * 1024, mapping};
+    bufferQueue bytesQueue{64 * 1024, mapping};
+    std::atomic<bool> res{true};
+
+    const auto start{std::chrono::steady_clock::now()};
+    std::thread pusher{[&typedQueue, &bytesQueue, numRecords](){
+        for (uint64_t seqno = 0 ; seqno < numRecords ; seqno++)
+        {
+            if constexpr (typed)
+            {
+                switch (seqno % 3)
+                {
+                    case 0: while (!typedQueue.push(heartbeat{seqno, 7})) std::this_thread::yield(); break;
+                    case 1: while (!typedQueue.emplace<order>(seqno, 100.5, 10u, 'B')) std::this_thread::yield(); break;
+                    default: while (!typedQueue.emplace<quote>(quote{seqno, {1.0, 2.0, 3.0, 4.0}, {5.0, 6.0, 7.0, 8.0}})) std::this_thread::yield(); break;
+                }
+            }
+            else
+            {
+                // what the consumers do without the typed layer, a type byte then the struct's bytes
+                char record[1 + sizeof(quote)];
+                size_t len{1};
+                record[0] = static_cast<char>(seqno % 3);
+                switch (seqno % 3)
+                {
+                    case 0: { const heartbeat h{seqno, 7}; std::memcpy(record + 1, &h, sizeof(h)); len += sizeof(h); break; }
+                    case 1: { const order o{seqno, 100.5, 10u, 'B'}; std::memcpy(record + 1, &o, sizeof(o)); len += sizeof(o); break; }
+                    default: { const quote q{seqno, {1.0, 2.0, 3.0, 4.0}, {5.0, 6.0, 7.0, 8.0}}; std::memcpy(record + 1, &q, sizeof(q)); len += sizeof(q); break; }
+                }
+                while (!bytesQueue.push(record, len))
+                    std::this_thread::yield();
+            }
+        }
+    }};
+
+    uint64_t expected{0};
+    size_t misaligned{0};
+    auto check{[&res, &expected, &misaligned](const auto& obj, bool valid){
+        misaligned += reinterpret_cast<uintptr_t>(&obj) % alignof(decltype(obj)) != 0;
+        if (!valid || obj._seqno != expected)
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: expected: " << expected << ", received: " << obj._seqno << std::endl;
+            res = false;
+        }
+        expected++;
+    }};
+    std::string buffer;
+    while (expected < numRecords && res)
+    {
+        if constexpr (typed)
+        {
+            const auto visited{typedQueue.visit(overloaded{
+                [&check, &expected](const heartbeat& h){ check(h, expected % 3 == 0 && h._source == 7); },
+                [&check, &expected](const order& o){ check(o, expected % 3 == 1 && o._quantity == 10 && o._side == 'B'); },
+                [&check, &expected](const quote& q){ check(q, expected % 3 == 2 && q._asks[3] == 8.0); }
+            }, 64)};
+            if (visited == 0)
+                std::this_thread::yield();
+        }
+        else
+        {
+            auto [ptr, len] = bytesQueue.front(buffer);
+            if (ptr == nullptr)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            switch (ptr[0])
+            {
+                case 0: { heartbeat h; std::memcpy(&h, ptr + 1, sizeof(h)); check(h, expected % 3 == 0 && h._source == 7); break; }
+                case 1: { order o; std::memcpy(&o, ptr + 1, sizeof(o)); check(o, expected % 3 == 1 && o._quantity == 10 && o._side == 'B'); break; }
+                default: { quote q; std::memcpy(&q, ptr + 1, sizeof(q)); check(q, expected % 3 == 2 && q._asks[3] == 8.0); break; }
+            }
+            bytesQueue.pop();
+        }
+    }
+    pusher.join();
+    const auto timeUs{std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()};
+
+    std::cout << (typed ? "typed push/visit          " : "bytes push/front/memcpy   ") << ": mapping: " << static_cast<int>(mapping)
+              << ", records: " << expected << ", records per sec: " << expected * 1'000'000 / static_cast<size_t>(timeUs + 1) << std::endl;
+    if (misaligned != 0)
+    {
+        std::cout << __FILE__ << ':' << __LINE__ << " - Error: " << misaligned << " misaligned objects" << std::endl;
+        return false;
+    }
+    return res && (typed ? typedQueue.empty() : bytesQueue.empty());
+}
+
+bool testTyped()
+{
+	std::cout << __FUNCTION__ << " Test : typed records " << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+    typedBufferQueue<heartbeat, order, quote> queue{4096};
+    std::cout << queue << ", mirrored: " << queue.mirrored() << std::endl;
+
+    const size_t numRecords{2'000'000};
+    for (const auto mapping : {bufferMapping::heap, bufferMapping::mirrored})
+    {
+        if (!testTypedThroughput<false>(mapping, numRecords) || !testTypedThroughput<true>(mapping, numRecords))
+            return false;
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+/*
+    large messages go around a small ring, the snapshots are written straight into pool buffers
+*/
+void fillLarge(size_t seqno, char* data, size_t len)
+{
+    std::memcpy(data, &seqno, sizeof(seqno));
+    for (size_t i = sizeof(seqno) ; i < len ; i++)
+    {
+        data[i] = static_cast<char>((seqno + i) % 251);
+    }
+}
+bool verifyLarge(size_t seqno, const char* data, size_t len)
+{
+    size_t received{0};
+    std::memcpy(&received, data, sizeof(received));
+    if (received != seqno)
+    {
+        return false;
+    }
+    for (size_t i = sizeof(seqno) ; i < len ; i++)
+    {
+        if (data[i] != static_cast<char>((seqno + i) % 251))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testLargeMessages()
+{
+	std::cout << __FUNCTION__ << " Test : out of line large messages " << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+    constexpr static size_t SnapshotEvery{500};
+    constexpr static size_t LargeEvery{250};
+    auto expectedLen{[](size_t seqno) -> size_t {
+        if (seqno % SnapshotEvery == 0)
+            return (seqno / SnapshotEvery % 10 + 1) * 1024 * 1024;
+        if (seqno % LargeEvery == 0)
+            return 8 * 1024;
+        return 0;
+    }};
+
+    // a bufferQueue would need a 16MB ring for the 10MB snapshots
+    bufferQueueLarge queue{64 * 1024, 4096};
+    std::cout << queue << std::endl;
+    const size_t numRecords{20'000};
+
+    std::thread pusher{[&queue, &expectedLen, numRecords](){
+        std::string data;
+        for (size_t seqno = 0 ; seqno < numRecords ; seqno++)
+        {
+            const auto len{expectedLen(seqno)};
+            if (seqno % SnapshotEvery == 0)
+            {
+                auto buffer{queue.allocate(len)};
+                fillLarge(seqno, buffer.data(), len);
+                while (!queue.push(std::move(buffer)))
+                    std::this_thread::yield();
+                continue;
+            }
+            if (len > 0)
+            {
+                data.resize(len);
+                fillLarge(seqno, data.data(), len);
+            }
+            else
+            {
+                makeData(seqno, data);
+            }
+            while (!queue.push(data.c_str(), data.size()))
+                std::this_thread::yield();
+        }
+    }};
+
+    std::string buffer, expected;
+    size_t taken{0};
+    for (size_t seqno = 0 ; seqno < numRecords ; )
+    {
+        const auto len{expectedLen(seqno)};
+        // every other snapshot is kept by the consumer for a while
+        if (seqno % SnapshotEvery == 0 && seqno / SnapshotEvery % 2 == 1)
+        {
+            auto snapshot{queue.take()};
+            if (!snapshot.valid())
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            if (snapshot.size() != len || !verifyLarge(seqno, snapshot.data(), len))
+            {
+                std::cout << __FILE__ << ':' << __LINE__ << " - Error: snapshot mismatch: seqno: " << seqno << std::endl;
+                std::terminate();
+            }
+            taken++;
+            seqno++;
+            continue;
+        }
+
+        auto [ptr, recvLen] = queue.front(buffer);
+        if (ptr == nullptr)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        bool valid{false};
+        if (len > 0)
+        {
+            valid = recvLen == len && verifyLarge(seqno, ptr, len);
+        }
+        else
+        {
+            makeData(seqno, expected);
+            valid = expected == std::string_view{ptr, recvLen};
+        }
+        if (!valid)
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: data mismatch: seqno: " << seqno << ", len: " << recvLen << std::endl;
+            std::terminate();
+        }
+        queue.pop();
+        seqno++;
+    }
+    pusher.join();
+
+    const size_t numLarge{numRecords / LargeEvery};
+    std::cout << queue << std::endl;
+    std::cout << "records: " << numRecords << ", out of line: " << numLarge << ", taken by the consumer: " << taken
+              << ", buffers allocated: " << queue.pool().allocations() << std::endl << std::endl;
+
+    // a full ring refuses a large message before allocating and copying it
+    bufferQueueLarge full{4096 - 1, 1024};
+    const std::string small(1, 's'), large(8 * 1024, 'l');
+    while (full.push(small.c_str(), small.size()));
+    if (full.push(large.c_str(), large.size()) || full.pool().allocations() != 0)
+    {
+        std::cout << __FILE__ << ':' << __LINE__ << " - Error: a large message was allocated for a full ring: " << full.pool().allocations() << std::endl;
+        return false;
+    }
+
+    // below threshold but longer than the ring goes out of line, a buffer of another pool goes back to its own pool
+    bufferQueueLarge ring{4096 - 1, 64 * 1024};
+    largeBufferPool otherPool{1024 * 1024};
+    const std::string mid(8 * 1024, 'm');
+    auto foreign{otherPool.allocate(large.size())};
+    std::memcpy(foreign.data(), large.data(), large.size());
+    if (!ring.push(mid.c_str(), mid.size()) || !ring.push(std::move(foreign)))
+    {
+        std::cout << __FILE__ << ':' << __LINE__ << " - Error: a message that doesn't fit inline was refused" << std::endl;
+        return false;
+    }
+    auto [ptr, len] = ring.front(buffer);
+    const bool midValid{std::string_view{ptr, len} == mid};
+    ring.pop();
+    std::tie(ptr, len) = ring.front(buffer);
+    const bool foreignValid{std::string_view{ptr, len} == large};
+    ring.pop();
+    if (!midValid || !foreignValid || ring.pool().allocations() != 1 || otherPool.allocations() != 1 || otherPool.allocate(large.size()).data() == nullptr
+        || otherPool.allocations() != 1)
+    {
+        std::cout << __FILE__ << ':' << __LINE__ << " - Error: out of line messages: " << ring << ", other pool: " << otherPool << std::endl;
+        return false;
+    }
+
+    // the pool reuses buffers, far fewer allocations than large messages
+    return queue.empty() && queue.pool().allocations() < numLarge / 2;
+}
+
+/*
+    numReaders threads see every record, through one multicast queue or a bufferQueue each
+*/
+template<bool multicast>
+bool testMulticastThroughput(size_t numReaders, size_t numRecords)
+{
+    bufferQueueMulticast multicastQueue{64 * 1024, numReaders};
+    std::vector<std::unique_ptr<bufferQueue>> queues;
+    std::vector<size_t> ids;
+    for (size_t i = 0 ; i < numReaders ; i++)
+    {
+        ids.push_back(multicastQueue.addReader());
+        queues.push_back(std::make_unique<bufferQueue>(64 * 1024, bufferMapping::mirrored));
+    }
+    std::atomic<bool> res{true};
+
+    const auto start{std::chrono::steady_clock::now()};
+    std::vector<std::thread> readers;
+    for (size_t i = 0 ; i < numReaders ; i++)
+    {
+        readers.emplace_back([&multicastQueue, &queues, &res, id = ids[i], i, numRecords](){
+            std::string buffer, expected;
+            size_t seqno{0};
+            auto check{[&res, &expected, &seqno](const char* ptr, size_t len){
+                makeData(seqno++ % 100, expected);
+                if (expected != std::string_view{ptr, len})
+                {
+                    std::cout << __FILE__ << ':' << __LINE__ << " - Error: data mismatch: expected: " << expected << std::endl;
+                    res = false;
+                }
+            }};
+            while (seqno < numRecords && res)
+            {
+                if constexpr (multicast)
+                {
+                    // half of the readers take batches
+                    if (i % 2 == 0)
+                    {
+                        if (multicastQueue.consume(id, check, buffer, 64) == 0)
+                            std::this_thread::yield();
+                        continue;
+                    }
+                    auto [ptr, len] = multicastQueue.front(id, buffer);
+                    if (ptr == nullptr)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    check(ptr, len);
+                    multicastQueue.pop(id);
+                }
+                else
+                {
+                    if (queues[i]->consume(check, 64) == 0)
+                        std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::string data;
+    for (size_t seqno = 0 ; seqno < numRecords && res ; seqno++)
+    {
+        makeData(seqno % 100, data);
+        if constexpr (multicast)
+        {
+            while (!multicastQueue.push(data.c_str(), data.size()))
+                std::this_thread::yield();
+        }
+        else
+        {
+            // a copy for every reader
+            for (auto& queue : queues)
+            {
+                while (!queue->push(data.c_str(), data.size()))
+                    std::this_thread::yield();
+            }
+        }
+    }
+    for (auto& t : readers)
+    {
+        t.join();
+    }
+    const auto timeUs{std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()};
+
+    std::cout << (multicast ? "one multicast queue  " : "a bufferQueue each   ") << ": readers: " << numReaders
+              << ", records: " << numRecords << ", records per sec: " << numRecords * 1'000'000 / static_cast<size_t>(timeUs + 1) << std::endl;
+    return res;
+}
+
+bool testMulticast()
+{
+	std::cout << __FUNCTION__ << " Test : multicast, independent readers " << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+    const std::string data(100, 'A');
+    std::string buffer;
+    // the fast reader reads every record right away, the slow one never reads
+    for (const auto policy : {lagPolicy::block, lagPolicy::cutOff})
+    {
+        bufferQueueMulticast queue{4096, 2, policy};
+        const auto fast{queue.addReader()};
+        const auto slow{queue.addReader()};
+        if (fast == SIZE_MAX || slow == SIZE_MAX || queue.addReader() != SIZE_MAX)
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: expected 2 reader slots" << std::endl;
+            return false;
+        }
+
+        size_t pushed{0};
+        for (; pushed < 1000 ; pushed++)
+        {
+            if (!queue.push(data.c_str(), data.size()))
+                break;
+            auto [ptr, len] = queue.front(fast, buffer);
+            if (ptr == nullptr || data != std::string_view{ptr, len} || !queue.pop(fast))
+            {
+                std::cout << __FILE__ << ':' << __LINE__ << " - Error: the fast reader missed record " << pushed << std::endl;
+                return false;
+            }
+        }
+        std::cout << queue << std::endl;
+        std::cout << "policy: " << static_cast<int>(policy) << ", pushed: " << pushed << ", slow reader cut off: " << queue.cutOff(slow) << std::endl;
+
+        if (policy == lagPolicy::block)
+        {
+            // the slow reader holds the ring, it has all of it to read
+            size_t read{0};
+            read += queue.consume(slow, [](const char*, size_t){}, buffer);
+            if (pushed == 1000 || read != pushed || queue.cutOff(slow) || queue.cutOffs() != 0)
+            {
+                std::cout << __FILE__ << ':' << __LINE__ << " - Error: pushed: " << pushed << ", read: " << read << std::endl;
+                return false;
+            }
+            continue;
+        }
+
+        if (pushed != 1000 || !queue.cutOff(slow) || queue.cutOffs() != 1 || queue.front(slow, buffer).first != nullptr || queue.pop(slow) || !queue.empty(slow))
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: the slow reader wasn't cut off" << std::endl;
+            return false;
+        }
+        // rejoins from the next record
+        queue.removeReader(slow);
+        if (queue.addReader() != slow || !queue.empty(slow) || !queue.push(data.c_str(), data.size()) || queue.front(slow, buffer).first == nullptr)
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: the slow reader didn't rejoin" << std::endl;
+            return false;
+        }
+
+        // cut off inside consume, the records written over after the cut don't reach the callback
+        for (size_t i = 0 ; i < 10 ; i++)
+        {
+            queue.push(data.c_str(), data.size());
+        }
+        const std::string other(100, 'B');
+        size_t seen{0}, torn{0};
+        const auto consumed{queue.consume(slow, [&](const char* ptr, size_t len){
+            seen++;
+            torn += data != std::string_view{ptr, len};
+            while (!queue.cutOff(slow) && queue.push(other.c_str(), other.size()));
+        }, buffer)};
+        if (consumed != 1 || seen != 1 || torn != 0 || !queue.cutOff(slow))
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: consumed: " << consumed << ", seen: " << seen << ", torn: " << torn << std::endl;
+            return false;
+        }
+    }
+
+    // readers join and leave while the producer pushes, a new reader starts on a whole record and reads them in order
+    for (const auto policy : {lagPolicy::block, lagPolicy::cutOff})
+    {
+        bufferQueueMulticast queue{4096, 1, policy};
+        std::atomic<bool> done{false};
+        std::thread pusher{[&queue, &done](){
+            std::string data;
+            for (size_t seqno = 0 ; !done ; )
+            {
+                makeData(seqno, data);
+                if (queue.push(data.c_str(), data.size()))
+                    seqno++;
+                else
+                    std::this_thread::yield();
+            }
+        }};
+        size_t errors{0};
+        std::string expected;
+        for (size_t round = 0 ; round < 1000 && errors == 0 ; round++)
+        {
+            const auto id{queue.addReader()};
+            size_t prev{SIZE_MAX};
+            for (size_t read = 0 ; read < 10 && !queue.cutOff(id) ; )
+            {
+                auto [ptr, len] = queue.front(id, buffer);
+                if (ptr == nullptr)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                const std::string record{ptr, len};
+                const size_t seqno{std::stoul(record)};
+                makeData(seqno, expected);
+                if (expected != record || (prev != SIZE_MAX && seqno != prev + 1))
+                {
+                    std::cout << __FILE__ << ':' << __LINE__ << " - Error: record " << seqno << " after " << prev << std::endl;
+                    errors++;
+                    break;
+                }
+                prev = seqno;
+                read++;
+                queue.pop(id);
+            }
+            queue.removeReader(id);
+        }
+        done = true;
+        pusher.join();
+        if (errors != 0)
+            return false;
+        std::cout << "policy: " << static_cast<int>(policy) << ", joins: 1000, cut offs: " << queue.cutOffs() << std::endl;
+    }
+
+    const size_t numRecords{1'000'000};
+    const size_t numReaders{4};
+    if (!testMulticastThroughput<false>(numReaders, numRecords) || !testMulticastThroughput<true>(numReaders, numRecords))
+        return false;
+    std::cout << std::endl;
+    return true;
+}
+
+/*
+    resident memory of this process, from /proc/self/statm
+*/
+size_t residentBytes()
+{
+    std::ifstream statm{"/proc/self/statm"};
+    size_t sizePages{0}, residentPages{0};
+    statm >> sizePages >> residentPages;
+    return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+/*
+    replays a trace of bursts: quiet periods where the consumer keeps up, then bursts it drains later.
+    returns false on a data mismatch, reports the time of the quiet periods and the resident memory
+*/
+template<typename QueueType>
+bool replayBursts(const char* name, std::function<std::unique_ptr<QueueType>()> makeQueue)
+{
+    static constexpr size_t MessageLen{200};
+    static constexpr size_t QuietRecords{200'000};
+    const std::array<size_t, 4> bursts{10'000, 60'000, 20'000, 5'000};
+
+    const auto baseline{residentBytes()};
+    auto queue{makeQueue()};
+    size_t peak{residentBytes() - baseline};
+    std::string data(MessageLen, 'A'), buffer;
+    size_t pushSeqno{0}, popSeqno{0};
+    std::chrono::steady_clock::duration quietTime{0};
+
+    auto push{[&](){
+        std::memcpy(data.data(), &pushSeqno, sizeof(pushSeqno));
+        if (!queue->push(data.c_str(), data.size()))
+            return false;
+        pushSeqno++;
+        return true;
+    }};
+    auto pop{[&](){
+        auto [ptr, len] = queue->front(buffer);
+        size_t val{0};
+        if (ptr != nullptr)
+            std::memcpy(&val, ptr, sizeof(val));
+        if (ptr == nullptr || len != MessageLen || val != popSeqno)
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: expected: " << popSeqno << ", received: " << val << std::endl;
+            return false;
+        }
+        popSeqno++;
+        return queue->pop();
+    }};
+
+    for (const auto burst : bursts)
+    {
+        const auto start{std::chrono::steady_clock::now()};
+        for (size_t i = 0 ; i < QuietRecords ; i++)
+        {
+            if (!push() || !pop())
+                return false;
+        }
+        quietTime += std::chrono::steady_clock::now() - start;
+
+        for (size_t i = 0 ; i < burst ; i++)
+        {
+            if (!push())
+            {
+                std::cout << __FILE__ << ':' << __LINE__ << " - Error: full after " << i << " records of a burst" << std::endl;
+                return false;
+            }
+        }
+        peak = std::max(peak, residentBytes() - baseline);
+        while (popSeqno < pushSeqno)
+        {
+            if (!pop())
+                return false;
+        }
+    }
+    const auto drained{residentBytes() - baseline};
+
+    const auto quietNs{std::chrono::duration_cast<std::chrono::nanoseconds>(quietTime).count()};
+    std::cout << name << ": records: " << pushSeqno
+              << ", quiet push+pop ns: " << static_cast<double>(quietNs) / static_cast<double>(QuietRecords * bursts.size())
+              << ", peak RSS KB: " << peak / 1024 << ", RSS after the bursts KB: " << drained / 1024 << std::endl;
+    return queue->empty();
+}
+
+bool testSegmented()
+{
+	std::cout << __FUNCTION__ << " Test : segmented queue" << std::endl;
+	std::cout << "-------------------------------------------------" << std::endl;
+
+    // small segments, the consumer lags and the producer links many of them
+    {
+        bufferQueueSegmented queue{1024, 1024, 2};
+        std::cout << queue << std::endl;
+        const size_t numRecords{500'000};
+        std::atomic<bool> res{true};
+        std::thread pusher{[&queue, numRecords](){
+            std::string data;
+            for (size_t seqno = 0 ; seqno < numRecords ; seqno++)
+            {
+                makeData(seqno % 100, data);
+                while (!queue.push(data.c_str(), data.size()))
+                    std::this_thread::yield();
+            }
+        }};
+        std::string buffer, expected;
+        for (size_t seqno = 0 ; seqno < numRecords && res ; )
+        {
+            auto [ptr, len] = queue.front(buffer);
+            if (ptr == nullptr)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            makeData(seqno % 100, expected);
+            if (expected != std::string_view{ptr, len})
+            {
+                std::cout << __FILE__ << ':' << __LINE__ << " - Error: data mismatch: seqno: " << seqno << std::endl;
+                res = false;
+            }
+            queue.pop();
+            seqno++;
+        }
+        pusher.join();
+        std::cout << queue << std::endl;
+        if (!res || !queue.empty() || queue.segments() > 3)
+            return false;
+    }
+
+    // the cap, and a record larger than a segment
+    {
+        bufferQueueSegmented queue{1024, 2, 0, bufferMapping::heap};
+        const std::string data(100, 'A');
+        size_t pushed{0};
+        while (queue.push(data.c_str(), data.size()))
+            pushed++;
+        const std::string large(8192, 'B');
+        std::string buffer;
+        if (pushed == 0 || queue.segments() != 2 || queue.push(large.c_str(), large.size()))
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: pushed: " << pushed << ", segments: " << queue.segments() << std::endl;
+            return false;
+        }
+        while (queue.front(buffer).first != nullptr)
+        {
+            queue.pop();
+            pushed--;
+        }
+        // the drained segment is freed, not kept
+        if (pushed != 0 || queue.segments() != 1)
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: left: " << pushed << ", segments: " << queue.segments() << std::endl;
+            return false;
+        }
+    }
+
+    // the fixed queue has to be allocated for the largest burst up front,
+    // capacities are rounded up to the power of two above them, - 1 gives 16MB and 1MB
+    std::cout << "replay a bursty trace, 200 bytes records" << std::endl;
+    if (!replayBursts<bufferQueue>("fixed 16MB        ", [](){ return std::make_unique<bufferQueue>(16 * 1024 * 1024 - 1); }))
+        return false;
+    if (!replayBursts<bufferQueueSegmented>("segmented 1MB x 32", [](){ return std::make_unique<bufferQueueSegmented>(1024 * 1024 - 1, 32); }))
+        return false;
+    std::cout << std::endl;
+    return true;
+}
+
 template<typename QueueType>
 bool testQueueMultiThread(size_t queueSize, size_t numProducers)
 {
@@ -409,18 +1719,50 @@ bool testQueueMultiConsumersThread(size_t queueSize, size_t numProducers, size_t
     return true;
 }
 
-int main(int /*argc*/, char* /*argv*/[])
+int main(int argc, char* argv[])
 {
+    // the long benchmarks, ./test_queueBuffer bench
+    if (argc > 1 && std::string{argv[1]} == "bench")
+    {
+        return benchJournalRestart() ? 0 : __LINE__;
+    }
+
 	if (!testInterface())
 		return __LINE__;
     if (!testRandomAgent())
         return __LINE__;
+    if (!testReserveCommit(bufferMapping::heap))
+        return __LINE__;
+    if (!testReserveCommit(bufferMapping::mirrored))
+        return __LINE__;
+    if (!testBatch())
+        return __LINE__;
+    if (!testScatterGather())
+        return __LINE__;
+    if (!testNonTemporal())
+        return __LINE__;
+    if (!testJournal())
+        return __LINE__;
+    if (!testSegmented())
+        return __LINE__;
+    if (!testCompactFraming())
+        return __LINE__;
+    if (!testTyped())
+        return __LINE__;
+    if (!testLargeMessages())
+        return __LINE__;
+    if (!testMulticast())
+        return __LINE__;
     if (!testQueueMultiThread<bufferQueueSyncSPSC>(1024, 1))
 		return __LINE__;
     if (!testQueueMultiThread<bufferQueueSyncMPSC>(1024, 5))
 		return __LINE__;
+    if (!testQueueMultiThread<bufferQueueMPSC>(1024, 5))
+		return __LINE__;
     if (!testQueueMultiConsumersThread<bufferQueueSyncSPMC>(1024, 1, 5))
 		return __LINE__;
+    if (!testQueueMultiConsumersThread<bufferQueueSPMC>(1024, 1, 5))
+		return __LINE__;
     if (!testQueueMultiConsumersThread<bufferQueueSyncMPMC>(1024, 5, 5))
 		return __LINE__;
 	return 0;
@@ -0,0 +1,263 @@
+#include "queueBuffer.h"
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+constexpr size_t producerShift{48}; // producer id in the high bits, its own counter in the low bits
+
+std::string queueName()
+{
+    return "/test_queueBufferShm_" + std::to_string(getpid());
+}
+
+// the seqno, then a body of a length that depends on it
+void makeData(size_t seqno, std::string& data)
+{
+    data.assign(reinterpret_cast<const char*>(&seqno), sizeof(seqno));
+    data.append((seqno & 0xffff) % 500, static_cast<char>('A' + seqno % 26));
+}
+bool verifyData(std::string_view received, size_t& seqno)
+{
+    if (received.size() < sizeof(seqno))
+    {
+        return false;
+    }
+    std::memcpy(&seqno, received.data(), sizeof(seqno));
+    std::string expected;
+    makeData(seqno, expected);
+    return expected == received;
+}
+
+template<typename Func>
+pid_t runChild(Func func)
+{
+    const auto pid{fork()};
+    if (pid == 0)
+    {
+        // no destructors, like a process that is killed
+        _exit(func() ? 0 : 1);
+    }
+    return pid;
+}
+bool waitChild(pid_t pid)
+{
+    int status{0};
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/*
+    producer processes push numRecords each, this process pops and checks every producer's order
+*/
+bool testProcesses(shmProducers producers, size_t numProducers, bool anonymous)
+{
+    std::cout << __FUNCTION__ << " Test : " << numProducers << " producer processes, one consumer process, "
+              << (anonymous ? "memfd" : "shm_open") << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+
+    const size_t numRecords{200'000};
+    const auto name{anonymous ? std::string{} : queueName()};
+    auto queue{bufferQueueShm::create(name, 64 * 1024, producers)};
+    std::cout << *queue << std::endl;
+
+    std::vector<pid_t> children;
+    for (size_t id = 0 ; id < numProducers ; id++)
+    {
+        children.push_back(runChild([&name, &queue, id, numRecords](){
+            auto attached{name.empty() ? bufferQueueShm::attach(queue->fd()) : bufferQueueShm::attach(name)};
+            std::string data;
+            for (size_t i = 0 ; i < numRecords ; i++)
+            {
+                makeData((id << producerShift) | i, data);
+                while (!attached->push(data.c_str(), data.size()))
+                    std::this_thread::yield();
+            }
+            return true;
+        }));
+    }
+
+    std::vector<size_t> expected(numProducers, 0);
+    std::string buffer;
+    for (size_t received = 0 ; received < numRecords * numProducers ; )
+    {
+        auto [ptr, len] = queue->front(buffer);
+        if (ptr == nullptr)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        size_t seqno{0};
+        const bool valid{verifyData({ptr, len}, seqno)};
+        const size_t id{seqno >> producerShift};
+        if (!valid || id >= numProducers || (seqno & ((size_t{1} << producerShift) - 1)) != expected[id])
+        {
+            std::cout << __FILE__ << ':' << __LINE__ << " - Error: data mismatch: producer: " << id << ", seqno: " << seqno << std::endl;
+            for (const auto pid : children)
+            {
+                kill(pid, SIGKILL);
+                waitChild(pid);
+            }
+            return false;
+        }
+        expected[id]++;
+        received++;
+        queue->pop();
+    }
+
+    bool res{queue->empty()};
+    for (const auto pid : children)
+    {
+        res = waitChild(pid) && res;
+    }
+    std::cout << "received: " << numRecords * numProducers << ", res: " << res << std::endl << std::endl;
+    return res;
+}
+
+bool testAttachErrors()
+{
+    std::cout << __FUNCTION__ << " Test : attach errors" << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+
+    try
+    {
+        bufferQueueShm::attach(queueName() + "_missing");
+        return false;
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "expected: " << e.what() << std::endl;
+    }
+
+    // shared memory that was not made by create()
+    const int fd{memfd_create("notAQueue", MFD_CLOEXEC)};
+    if (fd < 0 || ftruncate(fd, 64 * 1024) != 0)
+    {
+        return false;
+    }
+    try
+    {
+        bufferQueueShm::attach(fd);
+        close(fd);
+        return false;
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "expected: " << e.what() << std::endl << std::endl;
+    }
+    close(fd);
+    return true;
+}
+
+/*
+    round trip of a 64 bytes message between two processes, over a pair of shm queues and over a socketpair
+*/
+void printLatencies(const char* name, std::vector<int64_t>& latenciesNs)
+{
+    std::sort(latenciesNs.begin(), latenciesNs.end());
+    std::cout << name << ": round trips: " << latenciesNs.size()
+              << ", p50 ns: " << latenciesNs[latenciesNs.size() / 2]
+              << ", p99 ns: " << latenciesNs[latenciesNs.size() * 99 / 100]
+              << ", p99.9 ns: " << latenciesNs[latenciesNs.size() * 999 / 1000] << std::endl;
+}
+
+bool testLatency()
+{
+    std::cout << __FUNCTION__ << " Test : round trip latency, shm vs socketpair" << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+
+    const size_t numRoundTrips{100'000};
+    const std::string msg(64, 'A');
+    std::vector<int64_t> latenciesNs(numRoundTrips);
+
+    {
+        auto ping{bufferQueueShm::create("", 64 * 1024, shmProducers::single)};
+        auto pong{bufferQueueShm::create("", 64 * 1024, shmProducers::single)};
+        const auto pid{runChild([&ping, &pong, numRoundTrips](){
+            std::string buffer;
+            for (size_t i = 0 ; i < numRoundTrips ; )
+            {
+                auto [ptr, len] = ping->front(buffer);
+                if (ptr == nullptr)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                while (!pong->push(ptr, len))
+                    std::this_thread::yield();
+                ping->pop();
+                i++;
+            }
+            return true;
+        })};
+
+        std::string buffer;
+        for (size_t i = 0 ; i < numRoundTrips ; i++)
+        {
+            const auto start{std::chrono::steady_clock::now()};
+            ping->push(msg.c_str(), msg.size());
+            while (pong->front(buffer).first == nullptr)
+                std::this_thread::yield();
+            pong->pop();
+            latenciesNs[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+        if (!waitChild(pid))
+            return false;
+        printLatencies("shm queues", latenciesNs);
+    }
+
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) != 0)
+            return false;
+        const auto pid{runChild([&fds, numRoundTrips](){
+            char buffer[1024];
+            for (size_t i = 0 ; i < numRoundTrips ; i++)
+            {
+                const auto len{read(fds[1], buffer, sizeof(buffer))};
+                if (len <= 0 || write(fds[1], buffer, static_cast<size_t>(len)) != len)
+                    return false;
+            }
+            return true;
+        })};
+
+        char buffer[1024];
+        for (size_t i = 0 ; i < numRoundTrips ; i++)
+        {
+            const auto start{std::chrono::steady_clock::now()};
+            if (write(fds[0], msg.c_str(), msg.size()) != static_cast<ssize_t>(msg.size()) ||
+                read(fds[0], buffer, sizeof(buffer)) != static_cast<ssize_t>(msg.size()))
+                return false;
+            latenciesNs[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+        close(fds[0]);
+        close(fds[1]);
+        if (!waitChild(pid))
+            return false;
+        printLatencies("socketpair", latenciesNs);
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+    if (!testAttachErrors())
+        return __LINE__;
+    if (!testProcesses(shmProducers::single, 1, false))
+        return __LINE__;
+    if (!testProcesses(shmProducers::single, 1, true))
+        return __LINE__;
+    if (!testProcesses(shmProducers::multi, 4, false))
+        return __LINE__;
+    if (!testLatency())
+        return __LINE__;
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include "lockfreeQueue.h"
+#include "lockfreeQueue2.h"
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <ctime>
+
+constexpr size_t numEvents{100'000};
+
+double threadCpuMs()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) * 1000.0 + static_cast<double>(ts.tv_nsec) / 1'000'000.0;
+}
+
+/*
+    one producer blocks on push_wait/push, one consumer blocks on pop_wait/pop
+*/
+template<typename queue_t, typename pushFunc_t, typename popFunc_t>
+bool testBlocking(queue_t& q, pushFunc_t pushFunc, popFunc_t popFunc)
+{
+    std::cout << __FUNCTION__ << " Test : blocking push/pop, queue: " << typeid(queue_t).name() << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+
+    size_t pushedSum{0}, pulledSum{0};
+    const auto start{std::chrono::steady_clock::now()};
+
+    std::thread pusher{[&q, &pushFunc, &pushedSum](){
+        for (size_t i = 0 ; i < numEvents ; ++i)
+        {
+            pushFunc(q, i);
+            pushedSum += i;
+        }
+    }};
+    std::thread puller{[&q, &popFunc, &pulledSum](){
+        for (size_t i = 0 ; i < numEvents ; ++i)
+        {
+            pulledSum += popFunc(q);
+        }
+    }};
+    pusher.join();
+    puller.join();
+
+    const auto timeMs{std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()};
+    std::cout << "events: " << numEvents << ", time ms: " << timeMs
+              << ", pushed sum: " << pushedSum << ", pulled sum: " << pulledSum
+              << " , verdict : " << (pushedSum == pulledSum ? "OK" : "FAIL") << std::endl << std::endl;
+    return pushedSum == pulledSum;
+}
+
+template<typename queue_t>
+bool testTryPopFor(queue_t& q)
+{
+    std::cout << __FUNCTION__ << " Test : try_pop_for, queue: " << typeid(queue_t).name() << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+
+    // empty, times out
+    const auto timeout{std::chrono::milliseconds{50}};
+    const auto start{std::chrono::steady_clock::now()};
+    auto res{q.try_pop_for(timeout)};
+    const auto elapsed{std::chrono::steady_clock::now() - start};
+    if (res || elapsed < timeout)
+    {
+        std::cout << __FUNCTION__ << ':' << __LINE__ << " expected a timeout after "
+                  << timeout.count() << " ms, elapsed: " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << std::endl;
+        return false;
+    }
+
+    // a value arrives while waiting
+    std::thread pusher{[&q](){
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        q.push(size_t{42});
+    }};
+    res = q.try_pop_for(std::chrono::seconds{10});
+    pusher.join();
+    if (!res || *res != 42)
+    {
+        std::cout << __FUNCTION__ << ':' << __LINE__ << " expected 42" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*
+    cpu burned by a consumer waiting on an empty queue, only parking should be close to 0
+*/
+template<typename queue_t>
+double idleConsumerCpuMs(queue_t& q, std::chrono::milliseconds idle)
+{
+    double cpuMs{0.0};
+    std::thread puller{[&q, &cpuMs](){
+        const auto startCpu{threadCpuMs()};
+        size_t v{0};
+        q.pop_wait(v);
+        cpuMs = threadCpuMs() - startCpu;
+    }};
+    std::this_thread::sleep_for(idle);
+    q.push(size_t{1});
+    puller.join();
+
+    std::cout << "idle consumer for " << idle.count() << " ms, cpu ms: " << cpuMs << ", queue: " << typeid(queue_t).name() << std::endl;
+    return cpuMs;
+}
+
+template<typename Wait>
+bool testWaitStrategy()
+{
+    std::cout << " ---- wait strategy: " << typeid(Wait).name() << " ----" << std::endl;
+    {
+        concurency::m2oQueue<size_t, 1024, 1, concurency::commitMode::ordered, Wait> q;
+        auto push{[](auto& q, size_t v){ q.push_wait(v); }};
+        auto pop{[](auto& q){ size_t v{0}; q.pop_wait(v); return v; }};
+        if (!testBlocking(q, push, pop))
+            return false;
+        if (!testTryPopFor(q))
+            return false;
+    }
+    {
+        concurency::m2mHeapQueue<size_t, concurency::commitMode::perSlot, Wait> q{1024, 1};
+        auto push{[](auto& q, size_t v){ q.push_wait(v); }};
+        auto pop{[](auto& q){ size_t v{0}; q.pop_wait(v); return v; }};
+        if (!testBlocking(q, push, pop))
+            return false;
+        if (!testTryPopFor(q))
+            return false;
+    }
+    {
+        concurency_2026::QueueSPSC<size_t, 1024, Wait> q;
+        auto push{[](auto& q, size_t v){ q.push(v); }};
+        auto pop{[](auto& q){ size_t v{0}; q.pop(v); return v; }};
+        if (!testBlocking(q, push, pop))
+            return false;
+        if (!testTryPopFor(q))
+            return false;
+    }
+    return true;
+}
+
+/*
+    what notify() costs on the hot path when no one sleeps
+*/
+template<typename Notify>
+double notifyNs(Notify notify)
+{
+    constexpr size_t numNotifies{10'000'000};
+    const auto start{std::chrono::steady_clock::now()};
+    for (size_t i = 0 ; i < numNotifies ; ++i)
+    {
+        notify();
+    }
+    const auto timeNs{std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()};
+    return static_cast<double>(timeNs) / static_cast<double>(numNotifies);
+}
+
+bool testNotifyCost()
+{
+    std::cout << __FUNCTION__ << " Test : notify() with no sleepers" << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+
+    concurency::pauseWait pause;
+    concurency::parkWait<> park;
+    std::cout << "pauseWait ns: " << notifyNs([&pause](){ pause.notify(); })
+              << ", parkWait ns: " << notifyNs([&park](){ park.notify(); })
+              << " (membarrier: " << concurency::parkWait<>::asymmetricBarrier() << ")"
+              << ", seq_cst fence ns: " << notifyNs([](){ std::atomic_thread_fence(std::memory_order_seq_cst); }) << std::endl << std::endl;
+    return true;
+}
+
+bool testIdleCpu()
+{
+    std::cout << __FUNCTION__ << " Test : cpu of an idle consumer" << std::endl;
+    std::cout << "-------------------------------------------------" << std::endl;
+
+    const auto idle{std::chrono::milliseconds{300}};
+    {
+        concurency::m2oQueue<size_t, 16, 1, concurency::commitMode::ordered, concurency::yieldWait> q;
+        idleConsumerCpuMs(q, idle);
+    }
+
+    concurency::m2oQueue<size_t, 16, 1, concurency::commitMode::ordered, concurency::parkWait<>> q;
+    const auto cpuMs{idleConsumerCpuMs(q, idle)};
+    if (cpuMs > static_cast<double>(idle.count()) / 10.0)
+    {
+        std::cout << __FUNCTION__ << ':' << __LINE__ << " parked consumer burned " << cpuMs << " ms" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int /*argc*/, char* /*argv*/[])
+{
+    if (!testWaitStrategy<concurency::busySpinWait>())
+        return __LINE__;
+    if (!testWaitStrategy<concurency::pauseWait>())
+        return __LINE__;
+    if (!testWaitStrategy<concurency::yieldWait>())
+        return __LINE__;
+    if (!testWaitStrategy<concurency::sleepWait<>>())
+        return __LINE__;
+    if (!testWaitStrategy<concurency::parkWait<>>())
+        return __LINE__;
+    if (!testNotifyCost())
+        return __LINE__;
+    if (!testIdleCpu())
+        return __LINE__;
+    return 0;
+}
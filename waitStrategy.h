@@ -0,0 +1,309 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h> // For _mm_pause on x86
+#endif
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace concurency
+{
+	/*
+		how a thread waits for a queue to become ready (not empty / not full).
+
+		every strategy has:
+			wait(ready)                  - returns when ready() is true
+			wait_until(ready, deadline)  - false if ready() is still false at deadline
+			notify()                     - called after the queue state changed,
+			                               it's on the hot path so it should cost nothing when no one sleeps
+
+		the queues keep one instance per condition.
+	*/
+
+	inline void cpuRelax()
+	{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+		_mm_pause();
+#elif defined(__aarch64__)
+		asm volatile("yield");
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+	/*
+		spins on the condition, the lowest latency, takes a whole core
+	*/
+	struct busySpinWait
+	{
+		template <typename Pred>
+		void wait(Pred ready)
+		{
+			while (!ready());
+		}
+		template <typename Pred, typename Clock, typename Duration>
+		bool wait_until(Pred ready, const std::chrono::time_point<Clock, Duration>& deadline)
+		{
+			while (!ready())
+			{
+				if (Clock::now() >= deadline)
+					return false;
+			}
+			return true;
+		}
+		void notify() {}
+	};
+
+	/*
+		spins with a pause between the checks, easier on the sibling hyper thread and the memory bus
+	*/
+	struct pauseWait
+	{
+		template <typename Pred>
+		void wait(Pred ready)
+		{
+			while (!ready())
+				cpuRelax();
+		}
+		template <typename Pred, typename Clock, typename Duration>
+		bool wait_until(Pred ready, const std::chrono::time_point<Clock, Duration>& deadline)
+		{
+			while (!ready())
+			{
+				if (Clock::now() >= deadline)
+					return false;
+				cpuRelax();
+			}
+			return true;
+		}
+		void notify() {}
+	};
+
+	/*
+		gives the core to another thread between the checks
+	*/
+	struct yieldWait
+	{
+		template <typename Pred>
+		void wait(Pred ready)
+		{
+			while (!ready())
+				std::this_thread::yield();
+		}
+		template <typename Pred, typename Clock, typename Duration>
+		bool wait_until(Pred ready, const std::chrono::time_point<Clock, Duration>& deadline)
+		{
+			while (!ready())
+			{
+				if (Clock::now() >= deadline)
+					return false;
+				std::this_thread::yield();
+			}
+			return true;
+		}
+		void notify() {}
+	};
+
+	/*
+		sleeps IntervalUs between the checks, no wakeups at all, the latency is up to IntervalUs
+	*/
+	template <size_t IntervalUs = 50>
+	struct sleepWait
+	{
+		template <typename Pred>
+		void wait(Pred ready)
+		{
+			while (!ready())
+				std::this_thread::sleep_for(std::chrono::microseconds{ IntervalUs });
+		}
+		template <typename Pred, typename Clock, typename Duration>
+		bool wait_until(Pred ready, const std::chrono::time_point<Clock, Duration>& deadline)
+		{
+			while (!ready())
+			{
+				if (Clock::now() >= deadline)
+					return false;
+				std::this_thread::sleep_for(std::chrono::microseconds{ IntervalUs });
+			}
+			return true;
+		}
+		void notify() {}
+	};
+
+	/*
+		spins SpinCount times, then parks the thread on a futex (condition variable where there is no futex).
+
+		it's an event count: a waiter registers in m_sleepers, reads m_epoch and checks the condition once more
+		before it sleeps on m_epoch. notify() bumps m_epoch and wakes only if someone registered,
+		so the wakeups are coalesced and a notify with no sleepers is a load, no syscall.
+		the waiter's registration and the notifier's check of m_sleepers need a full barrier between a store and a load
+		on both sides. on Linux with membarrier (4.14 and later) the waiter issues it for both with one
+		MEMBARRIER_CMD_PRIVATE_EXPEDITED when it's about to park, and notify() has only a compiler barrier.
+		without it notify() has a seq_cst fence (mfence, ~30 cycles on x86) on every push/pop, test_wait prints the cost.
+	*/
+	template <size_t SpinCount = 1024>
+	class alignas(64) parkWait
+	{
+	public:
+		template <typename Pred>
+		void wait(Pred ready)
+		{
+			if (spin(ready))
+				return;
+
+			while (true)
+			{
+				const uint32_t epoch{ prepare() };
+				if (ready())
+				{
+					cancel();
+					return;
+				}
+				park(epoch, nullptr);
+				cancel();
+				if (ready())
+					return;
+			}
+		}
+		template <typename Pred, typename Clock, typename Duration>
+		bool wait_until(Pred ready, const std::chrono::time_point<Clock, Duration>& deadline)
+		{
+			if (spin(ready))
+				return true;
+
+			while (true)
+			{
+				const auto now{ Clock::now() };
+				if (now >= deadline)
+					return ready();
+
+				const uint32_t epoch{ prepare() };
+				if (ready())
+				{
+					cancel();
+					return true;
+				}
+				const auto timeout{ std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now) };
+				park(epoch, &timeout);
+				cancel();
+				if (ready())
+					return true;
+			}
+		}
+		void notify()
+		{
+			// pairs with prepare(), either the waiter sees the new state or we see the waiter
+			if (asymmetricBarrier())
+				std::atomic_signal_fence(std::memory_order_seq_cst);
+			else
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_sleepers.load(std::memory_order_relaxed) == 0)
+				return;
+
+			m_epoch.fetch_add(1, std::memory_order_seq_cst);
+			wake();
+		}
+
+		// notify() is fence free, the barrier is paid by the waiter that parks
+		static bool asymmetricBarrier()
+		{
+#if defined(__linux__)
+			// once per process, fails on kernels without membarrier or where a seccomp filter denies it
+			static const bool registered{ syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0 };
+			return registered;
+#else
+			return false;
+#endif
+		}
+
+	private:
+		template <typename Pred>
+		static bool spin(Pred& ready)
+		{
+			for (size_t i = 0; i < SpinCount; ++i)
+			{
+				if (ready())
+					return true;
+				cpuRelax();
+			}
+			return false;
+		}
+		uint32_t prepare()
+		{
+			m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+#if defined(__linux__)
+			if (asymmetricBarrier())
+			{
+				// a full barrier on every running thread of the process, a notifier past it sees m_sleepers,
+				// one before it published its state before the ready() that follows
+				syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+			}
+#endif
+			return m_epoch.load(std::memory_order_seq_cst);
+		}
+		void cancel()
+		{
+			m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+#if defined(__linux__)
+		void park(uint32_t epoch, const std::chrono::nanoseconds* timeout)
+		{
+			static_assert(sizeof(m_epoch) == sizeof(uint32_t), "futex needs a plain 32 bit word");
+			timespec ts{};
+			if (timeout != nullptr)
+			{
+				ts.tv_sec = static_cast<time_t>(timeout->count() / 1'000'000'000);
+				ts.tv_nsec = static_cast<long>(timeout->count() % 1'000'000'000);
+			}
+			// returns at once if m_epoch moved since prepare()
+			syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_epoch), FUTEX_WAIT_PRIVATE, epoch, timeout != nullptr ? &ts : nullptr, nullptr, 0);
+		}
+		void wake()
+		{
+			syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_epoch), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+		}
+#else
+		void park(uint32_t epoch, const std::chrono::nanoseconds* timeout)
+		{
+			std::unique_lock<std::mutex> l{ m_mtx };
+			auto moved{ [this, epoch]() { return m_epoch.load(std::memory_order_seq_cst) != epoch; } };
+			if (timeout != nullptr)
+				m_cv.wait_for(l, *timeout, moved);
+			else
+				m_cv.wait(l, moved);
+		}
+		void wake()
+		{
+			// the lock orders the wake after a waiter that checked m_epoch and is about to sleep
+			{
+				std::lock_guard<std::mutex> l{ m_mtx };
+			}
+			m_cv.notify_all();
+		}
+
+		std::mutex m_mtx;
+		std::condition_variable m_cv;
+#endif
+
+		std::atomic<uint32_t> m_epoch{ 0 };
+		std::atomic<uint32_t> m_sleepers{ 0 };
+	};
+
+};